@@ -10,6 +10,9 @@
 
 #include <fcntl.h>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
 
 #ifndef O_TEXT
 #define O_TEXT 0
@@ -17,6 +20,22 @@
 
 int main(int argc, char* argv[])
 {
+	// "GiraffeChess bench [depth] [threads]" runs the bench and exits, any other argument is a file to read the UCI commands from
+	if (argc > 1 && std::string_view{ argv[1] } == "bench")
+	{
+		// Parsed the same way as the UCI "bench" command: a malformed depth reads as 0, which bench() rejects
+		std::string args;
+		for (int i = 2; i < argc; ++i)
+			(args += argv[i]) += ' ';
+
+		size_t depth = UciServer::defaultBenchDepth, threads = 1;
+		std::istringstream{ args } >> depth >> threads;
+
+		UciServer uciServer;
+		uciServer.bench(depth, threads);
+		return 0;
+	}
+
 	int fd = -1;
 	if (argc > 1)
 	{
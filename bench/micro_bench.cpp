@@ -0,0 +1,299 @@
+#include "board.h"
+#include "eval.h"
+#include "notation.h"
+#include "perft.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Times single board operations over a corpus of positions: the perft suite positions and every position one move away from them.
+// Each operation is warmed up, then timed in several samples, each sample being a number of passes over the whole corpus.
+
+struct Settings {
+	std::string epdPath = "../test/standard.epd";
+	size_t positions = 0; // 0 for the whole suite
+	size_t samples = 15;
+	double sampleMs = 20.0;
+	double warmupMs = 100.0;
+	std::string filter;
+};
+
+struct Stats {
+	double min = 0.0;
+	double median = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+};
+
+// Every operation result is folded into this, so that the compiler can't drop the work
+static volatile uint64_t sink = 0;
+
+static void printUsage()
+{
+	std::cout << "Usage: micro_bench [options]\n"
+		"  --epd <path>            perft suite to take the positions from (default ../test/standard.epd)\n"
+		"  --positions <N>         number of suite positions to use, 0 for all (default 0)\n"
+		"  --samples <N>           timed samples per operation (default 15)\n"
+		"  --sample-ms <ms>        minimum duration of one sample (default 20)\n"
+		"  --warmup-ms <ms>        untimed run before the samples (default 100)\n"
+		"  --filter <text>         only run the operations whose name contains the text\n";
+}
+
+static bool parseArguments(int argc, char* argv[], Settings& settings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (i + 1 >= argc)
+			return false;
+
+		const char* value = argv[++i];
+		if (arg == "--epd")
+			settings.epdPath = value;
+		else if (arg == "--positions")
+			settings.positions = std::stoull(value);
+		else if (arg == "--samples")
+			settings.samples = std::max(std::stoull(value), 1ull);
+		else if (arg == "--sample-ms")
+			settings.sampleMs = std::stod(value);
+		else if (arg == "--warmup-ms")
+			settings.warmupMs = std::stod(value);
+		else if (arg == "--filter")
+			settings.filter = value;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+static Stats computeStats(std::vector<double> values)
+{
+	Stats stats;
+	stats.min = std::numeric_limits<double>::max();
+	for (double v : values)
+	{
+		stats.min = std::min(stats.min, v);
+		stats.mean += v;
+	}
+	stats.mean /= (double)values.size();
+
+	for (double v : values)
+		stats.stddev += (v - stats.mean) * (v - stats.mean);
+	stats.stddev = std::sqrt(stats.stddev / (double)values.size());
+
+	std::nth_element(values.begin(), values.begin() + (std::ptrdiff_t)values.size() / 2, values.end());
+	stats.median = values[values.size() / 2];
+
+	return stats;
+}
+
+// 'pass' runs the operation once for every item of the corpus, which is 'opsPerPass' operations
+static void runBenchmark(std::string_view name, size_t opsPerPass, const std::function<uint64_t()>& pass, const Settings& settings)
+{
+	if (!settings.filter.empty() && name.find(settings.filter) == std::string_view::npos)
+		return;
+
+	using Clock = std::chrono::steady_clock;
+	const auto msSince = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	// The warmup also measures a pass, which tells how many passes make up a sample
+	size_t warmupPasses = 0;
+	const auto warmupStart = Clock::now();
+	do
+	{
+		sink = sink + pass();
+		++warmupPasses;
+	} while (msSince(warmupStart) < settings.warmupMs);
+
+	const double msPerPass = msSince(warmupStart) / (double)warmupPasses;
+	const size_t passesPerSample = std::max((size_t)std::ceil(settings.sampleMs / msPerPass), size_t{ 1 });
+
+	std::vector<double> nsPerOp;
+	for (size_t sample = 0; sample < settings.samples; ++sample)
+	{
+		const auto start = Clock::now();
+		for (size_t i = 0; i < passesPerSample; ++i)
+			sink = sink + pass();
+
+		nsPerOp.push_back(msSince(start) * 1e6 / (double)(passesPerSample * opsPerPass));
+	}
+
+	const Stats stats = computeStats(std::move(nsPerOp));
+	std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(10) << stats.median << std::setw(10) << stats.min << std::setw(9) << stats.stddev / stats.mean * 100.0 << '%'
+		<< std::setw(14) << (uint64_t)(1e9 / stats.median) << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings))
+	{
+		printUsage();
+		return 2;
+	}
+
+	const auto suite = loadPerftSuite(settings.epdPath);
+	if (suite.empty())
+	{
+		std::cerr << "Could not read " << settings.epdPath << '\n';
+		return 2;
+	}
+
+	// The corpus boards are only ever copied from, never used directly: the attack map cache of a const Board is filled on demand,
+	// and the operations that fill it have to start without it each time to be timed fairly.
+	std::vector<Board> corpus;
+	const size_t suitePositions = settings.positions == 0 ? suite.size() : std::min(settings.positions, suite.size());
+	for (size_t i = 0; i < suitePositions; ++i)
+	{
+		Board board = boardFromFEN(suite[i].fen);
+		corpus.push_back(board);
+
+		MoveList moves;
+		board.generateLegalMoves(moves);
+		for (Move move : moves)
+		{
+			const auto rollbackInfo = board.applyMove(move);
+			corpus.push_back(board);
+			board.rollbackMove(move, rollbackInfo);
+		}
+	}
+
+	std::vector<std::string> fens;
+	std::vector<MoveList> legalMoves(corpus.size());
+	size_t totalMoves = 0;
+	for (size_t i = 0; i < corpus.size(); ++i)
+	{
+		Board board = corpus[i];
+		fens.push_back(generateFEN(board));
+		board.generateLegalMoves(legalMoves[i]);
+		totalMoves += legalMoves[i].count();
+	}
+
+	std::cout << corpus.size() << " positions, " << totalMoves << " legal moves\n\n";
+	std::cout << std::left << std::setw(28) << "operation" << std::right
+		<< std::setw(10) << "ns/op" << std::setw(10) << "min" << std::setw(10) << "stddev" << std::setw(14) << "ops/sec" << '\n';
+
+	const size_t n = corpus.size();
+
+	// Copying a board is a part of every operation below that works on a fresh copy; this is its cost alone
+	std::vector<Board> copies(n);
+	runBenchmark("board copy", n, [&] {
+		for (size_t i = 0; i < n; ++i)
+			copies[i] = corpus[i];
+		return copies[n / 2].hash();
+	}, settings);
+
+	runBenchmark("parseFEN", n, [&] {
+		uint64_t result = 0;
+		for (const std::string& fen : fens)
+		{
+			result += boardFromFEN(fen).hash();
+		}
+		return result;
+	}, settings);
+
+	runBenchmark("generateMoves (copy)", n, [&] {
+		uint64_t result = 0;
+		for (const Board& position : corpus)
+		{
+			Board board = position;
+			MoveList moves;
+			board.generateMoves(board.sideToMove(), moves);
+			result += moves.count();
+		}
+		return result;
+	}, settings);
+
+	runBenchmark("generateLegalMoves (copy)", n, [&] {
+		uint64_t result = 0;
+		for (const Board& position : corpus)
+		{
+			Board board = position;
+			MoveList moves;
+			board.generateLegalMoves(moves);
+			result += moves.count();
+		}
+		return result;
+	}, settings);
+
+	runBenchmark("generateCaptures (copy)", n, [&] {
+		uint64_t result = 0;
+		for (const Board& position : corpus)
+		{
+			Board board = position;
+			MoveList moves;
+			board.generateCaptures(moves);
+			result += moves.count();
+		}
+		return result;
+	}, settings);
+
+	runBenchmark("isInCheck (copy)", n, [&] {
+		uint64_t result = 0;
+		for (const Board& position : corpus)
+		{
+			Board board = position;
+			result += board.isInCheck(board.sideToMove());
+		}
+		return result;
+	}, settings);
+
+	// Every legal move of every position, on one working copy per position; rollbackMove() leaves it as it was
+	runBenchmark("applyMove + rollbackMove", totalMoves, [&] {
+		uint64_t result = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			Board board = corpus[i];
+			for (Move move : legalMoves[i])
+			{
+				const auto rollbackInfo = board.applyMove(move);
+				result += board.hash();
+				board.rollbackMove(move, rollbackInfo);
+			}
+		}
+		return result;
+	}, settings);
+
+	// The alternative to rollbackMove(): every move is made on a fresh copy of the position, which is then thrown away
+	runBenchmark("copy + applyMove", totalMoves, [&] {
+		uint64_t result = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			for (Move move : legalMoves[i])
+			{
+				Board board = corpus[i];
+				board.applyMove(move);
+				result += board.hash();
+			}
+		}
+		return result;
+	}, settings);
+
+	runBenchmark("zobrist hash (full)", n, [&] {
+		uint64_t result = 0;
+		for (const Board& board : corpus)
+			result += board.computeHash();
+		return result;
+	}, settings);
+
+	runBenchmark("eval", n, [&] {
+		uint64_t result = 0;
+		for (const Board& board : corpus)
+			result += (uint64_t)eval(board);
+		return result;
+	}, settings);
+
+	return 0;
+}
@@ -0,0 +1,254 @@
+#include "board.h"
+#include "notation.h"
+#include "perft.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Runs a fixed selection of perft suite positions and reports the throughput, optionally comparing it against a saved baseline.
+// The selection is the first --positions entries of the suite, each at the deepest listed depth within --max-nodes.
+
+struct Settings {
+	std::string epdPath = "../test/standard.epd";
+	uint64_t maxNodes = 5'000'000;
+	size_t positions = 64;
+	size_t repeat = 3;
+	size_t threads = 1;
+	std::string jsonPath;
+	std::string csvPath;
+	std::string baselinePath;
+	double maxSlowdownPercent = 5.0;
+};
+
+struct BenchResult {
+	std::string fen;
+	size_t depth = 0;
+	uint64_t nodes = 0;
+	double seconds = 0.0;       // The fastest of the repetitions, the least disturbed by everything else running on the machine
+	double medianSeconds = 0.0;
+
+	[[nodiscard]] double nps() const noexcept { return (double)nodes / seconds; }
+};
+
+static void printUsage()
+{
+	std::cout << "Usage: perft_bench [options]\n"
+		"  --epd <path>            perft suite (default ../test/standard.epd)\n"
+		"  --positions <N>         number of positions to take from the suite (default 64)\n"
+		"  --max-nodes <N>         the deepest listed depth with at most N nodes is used (default 5000000)\n"
+		"  --repeat <N>            runs per position (default 3)\n"
+		"  --threads <N>           perft threads (default 1)\n"
+		"  --json <path>           write the results as JSON\n"
+		"  --csv <path>            write the results as CSV\n"
+		"  --baseline <path>       compare against a JSON file written by an earlier run\n"
+		"  --max-slowdown <pct>    fail if the total NPS is this much below the baseline (default 5)\n";
+}
+
+static bool parseArguments(int argc, char* argv[], Settings& settings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (i + 1 >= argc)
+			return false;
+
+		const char* value = argv[++i];
+		if (arg == "--epd")
+			settings.epdPath = value;
+		else if (arg == "--positions")
+			settings.positions = std::stoull(value);
+		else if (arg == "--max-nodes")
+			settings.maxNodes = std::stoull(value);
+		else if (arg == "--repeat")
+			settings.repeat = std::max(std::stoull(value), 1ull);
+		else if (arg == "--threads")
+			settings.threads = std::max(std::stoull(value), 1ull);
+		else if (arg == "--json")
+			settings.jsonPath = value;
+		else if (arg == "--csv")
+			settings.csvPath = value;
+		else if (arg == "--baseline")
+			settings.baselinePath = value;
+		else if (arg == "--max-slowdown")
+			settings.maxSlowdownPercent = std::stod(value);
+		else
+			return false;
+	}
+
+	return true;
+}
+
+static std::string trimmed(std::string s)
+{
+	while (!s.empty() && s.back() == ' ')
+		s.pop_back();
+	return s;
+}
+
+static void writeJson(std::ostream& os, const std::vector<BenchResult>& results, const BenchResult& total)
+{
+	// One position per line, so that readBaseline() doesn't need a JSON parser
+	os << "{\n\t\"positions\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult& r = results[i];
+		os << "\t\t{\"fen\": \"" << r.fen << "\", \"depth\": " << r.depth << ", \"nodes\": " << r.nodes
+			<< ", \"seconds\": " << r.seconds << ", \"median_seconds\": " << r.medianSeconds << ", \"nps\": " << (uint64_t)r.nps() << "}"
+			<< (i + 1 < results.size() ? "," : "") << '\n';
+	}
+
+	os << "\t],\n\t\"summary\": {\"nodes\": " << total.nodes << ", \"seconds\": " << total.seconds << ", \"nps\": " << (uint64_t)total.nps() << "}\n}\n";
+}
+
+static void writeCsv(std::ostream& os, const std::vector<BenchResult>& results)
+{
+	os << "fen,depth,nodes,seconds,median_seconds,nps\n";
+	for (const BenchResult& r : results)
+		os << '"' << r.fen << "\"," << r.depth << ',' << r.nodes << ',' << r.seconds << ',' << r.medianSeconds << ',' << (uint64_t)r.nps() << '\n';
+}
+
+// The value of "key": <number> following 'from' in the line
+static double numberAfter(const std::string& line, std::string_view key, size_t from = 0)
+{
+	const size_t pos = line.find(key, from);
+	return pos == std::string::npos ? 0.0 : std::atof(line.c_str() + pos + key.size());
+}
+
+// Reads the per-position NPS (keyed by FEN) and the total NPS (key "") from a JSON file written by writeJson()
+static std::map<std::string, double> readBaseline(const std::string& path)
+{
+	std::map<std::string, double> nps;
+	std::ifstream file{ path };
+	for (std::string line; std::getline(file, line); )
+	{
+		static constexpr std::string_view fenKey = "\"fen\": \"";
+		if (const size_t fenStart = line.find(fenKey); fenStart != std::string::npos)
+		{
+			const size_t fenEnd = line.find('"', fenStart + fenKey.size());
+			nps[line.substr(fenStart + fenKey.size(), fenEnd - fenStart - fenKey.size())] = numberAfter(line, "\"nps\": ", fenEnd);
+		}
+		else if (line.find("\"summary\"") != std::string::npos)
+			nps[""] = numberAfter(line, "\"nps\": ");
+	}
+
+	return nps;
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	if (!parseArguments(argc, argv, settings))
+	{
+		printUsage();
+		return 2;
+	}
+
+	const auto suite = loadPerftSuite(settings.epdPath);
+	if (suite.empty())
+	{
+		std::cerr << "Could not read " << settings.epdPath << '\n';
+		return 2;
+	}
+
+	std::vector<BenchResult> results;
+	BenchResult total;
+	bool nodeCountsMatch = true;
+
+	for (size_t i = 0; i < suite.size() && results.size() < settings.positions; ++i)
+	{
+		BenchResult result{ trimmed(suite[i].fen) };
+		uint64_t expectedNodes = 0;
+		for (const auto& depth : suite[i].expectedNodes)
+		{
+			if (depth.nodes <= settings.maxNodes && depth.depth > result.depth)
+			{
+				result.depth = depth.depth;
+				expectedNodes = depth.nodes;
+			}
+		}
+
+		if (result.depth == 0)
+			continue;
+
+		Board board = boardFromFEN(result.fen);
+
+		std::vector<double> times;
+		for (size_t run = 0; run < settings.repeat; ++run)
+		{
+			PerftResults perftResults;
+			const auto start = std::chrono::steady_clock::now();
+			perft(board, result.depth, perftResults, {}, { .threads = settings.threads });
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			result.nodes = perftResults.nodes;
+			result.seconds = run == 0 ? seconds : std::min(result.seconds, seconds);
+			times.push_back(seconds);
+		}
+
+		std::nth_element(times.begin(), times.begin() + (std::ptrdiff_t)times.size() / 2, times.end());
+		result.medianSeconds = times[times.size() / 2];
+
+		if (result.nodes != expectedNodes)
+		{
+			std::cerr << "Node count mismatch for " << result.fen << " at depth " << result.depth << ": " << result.nodes << " instead of " << expectedNodes << '\n';
+			nodeCountsMatch = false;
+		}
+
+		std::cout << result.fen << "  D" << result.depth << ": " << result.nodes << " nodes, " << result.seconds * 1e3 << " ms, " << result.nps() * 1e-6 << " MNps\n";
+		total.nodes += result.nodes;
+		total.seconds += result.seconds;
+		results.push_back(std::move(result));
+	}
+
+	std::cout << "\nTotal: " << total.nodes << " nodes, " << total.seconds << " s, " << total.nps() * 1e-6 << " MNps" << std::endl;
+
+	if (!settings.jsonPath.empty())
+	{
+		std::ofstream json{ settings.jsonPath };
+		writeJson(json, results, total);
+	}
+
+	if (!settings.csvPath.empty())
+	{
+		std::ofstream csv{ settings.csvPath };
+		writeCsv(csv, results);
+	}
+
+	if (!nodeCountsMatch)
+		return 1;
+
+	if (!settings.baselinePath.empty())
+	{
+		const auto baseline = readBaseline(settings.baselinePath);
+		const auto baselineTotal = baseline.find("");
+		if (baselineTotal == baseline.end() || baselineTotal->second <= 0.0)
+		{
+			std::cerr << "Could not read the baseline from " << settings.baselinePath << '\n';
+			return 2;
+		}
+
+		std::cout << "\nCompared to the baseline:\n";
+		for (const BenchResult& r : results)
+		{
+			if (const auto it = baseline.find(r.fen); it != baseline.end() && it->second > 0.0)
+				std::cout << r.fen << ": " << (r.nps() / it->second - 1.0) * 100.0 << "%\n";
+		}
+
+		const double change = (total.nps() / baselineTotal->second - 1.0) * 100.0;
+		std::cout << "Total: " << change << "%" << std::endl;
+		if (change < -settings.maxSlowdownPercent)
+		{
+			std::cerr << "The total NPS is " << -change << "% below the baseline, the limit is " << settings.maxSlowdownPercent << "%\n";
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -1,119 +1,12 @@
 #include "analyzer.h"
-#include "eval.h"
 #include "threading/thread_helpers.h"
 
 #include <assert/advanced_assert.h>
 
 #include <algorithm>
-#include <iostream>
-#include <ranges>
-
-struct Node {
-	inline constexpr Node() noexcept = default;
-
-	inline constexpr Node(float score_, uint8_t level_, uint8_t moveIndex_, uint8_t flags_) noexcept :
-		score(score_), level(level_), moveIndex(moveIndex_), flags(flags_)
-	{}
-
-	[[nodiscard]] inline constexpr bool isMate() const noexcept {
-		return flags & EvalFlags::Mate;
-	}
-
-	[[nodiscard]] inline constexpr bool isStalemate() const noexcept {
-		return flags & EvalFlags::Stalemate;
-	}
-
-	std::vector<Node> children;
-
-	float score = 0.0f;
-
-	uint8_t level = 0;
-	uint8_t moveIndex = 0;
-
-	uint8_t flags = EvalFlags::None;
-};
-
-static void generateMoveTree(const Board& board, Node* parent, uint8_t depthLimit) noexcept
-{
-	if (isDrawPosition(board)) [[unlikely]]
-	{
-		parent->flags = EvalFlags::Draw;
-		parent->score = 0.0f;
-		return;
-	}
-
-	MoveList moves;
-	board.generateMoves(board.sideToMove(), moves);
-
-	// The moves are pseudo-legal! Count will never be 0 here
-
-	const uint8_t depth = parent->level + 1;
-	const bool leaf = depth >= depthLimit;
-
-	uint8_t i = 0;
-	for (; i < moves.count(); ++i)
-	{
-		// TODO: rewind the move instead of full copying
-		Board nextBoard = board;
-		if (!nextBoard.applyMove(moves[i]))
-			continue;
-
-		auto& newNode = parent->children.emplace_back(leaf ? eval(nextBoard) : 0.0f, depth, i, EvalFlags::None);
-		if (!leaf)
-			generateMoveTree(nextBoard, &newNode, depthLimit);
-	}
-
-	if (i == 0) [[unlikely]]
-	{
-		if (board.isInCheck(board.sideToMove()))
-		{
-			parent->flags |= EvalFlags::Mate;
-			parent->score = board.sideToMove() == Color::White ? -1e5f : 1e5f;
-		}
-		else
-		{
-			parent->flags |= EvalFlags::Stalemate;
-			parent->score = 0.0f;
-		}
-	}
-}
-
-static float calcMinMaxScore(Node* node, Color sideToMove) noexcept
-{
-	if (node->children.empty()) // Terminal node
-		return node->score;
-
-	const bool max = sideToMove == White;
-	float result = max ? -1e30f : +1e30f;
-	for (auto& child : node->children)
-	{
-		if (max)
-			result = std::max(result, calcMinMaxScore(&child, oppositeSide(sideToMove)));
-		else
-			result = std::min(result, calcMinMaxScore(&child, oppositeSide(sideToMove)));
-	}
-
-	node->score = result;
-	return result;
-}
-
-static void printTree(const Node& node, std::ostream& os, size_t level = 0) noexcept
-{
-	os << std::string(level * 2, ' ') << "move: " << (int)node.moveIndex;
-	if (node.isMate())
-		os << " mate";
-	else if (node.isStalemate())
-		os << " stalemate";
-	else
-		os << ' ' << node.score;
-
-	os << '\n';
-
-	for (const auto& child : node.children)
-	{
-		printTree(child, os, level + 1);
-	}
-}
+#include <chrono>
+#include <memory>
+#include <thread>
 
 Analyzer::Analyzer() noexcept
 {
@@ -125,21 +18,41 @@ Analyzer::~Analyzer() noexcept
 	stop();
 }
 
-void Analyzer::start() noexcept
+void Analyzer::go(const SearchLimits& limits, SearchInfoCallback onInfo, BestMoveCallback onBestMove) noexcept
 {
-	assert_r(!_thread.isRunning());
+	stop();
+
+	_limits = limits;
+	_onInfo = std::move(onInfo);
+	_onBestMove = std::move(onBestMove);
+	_tt.newSearch();
 	_thread.start(&Analyzer::thread, this);
 }
 
 void Analyzer::stop() noexcept
 {
+	_stopRequested = true;
 	_thread.stop(true);
+	_stopRequested = false;
 }
 
 void Analyzer::startNewGame() noexcept
 {
 	assert_r(!_thread.isRunning()); // Analyzer must be stopped before starting a new game()
 	_previousPositionHashes.clear();
+	_tt.clear();
+}
+
+void Analyzer::setHashSize(size_t sizeMb) noexcept
+{
+	assert_r(!_thread.isRunning());
+	_tt.resize(sizeMb);
+}
+
+void Analyzer::setThreadCount(size_t threadCount) noexcept
+{
+	assert_r(!_thread.isRunning());
+	_threadCount = std::max(threadCount, size_t{ 1 });
 }
 
 void Analyzer::setInitialPosition(const Board& initialPosition) noexcept
@@ -148,9 +61,9 @@ void Analyzer::setInitialPosition(const Board& initialPosition) noexcept
 	_board = initialPosition;
 }
 
-Move Analyzer::findBestMove() noexcept
+Move Analyzer::findBestMove(const SearchLimits& limits) noexcept
 {
-	start();
+	go(limits);
 	// Wait for the thread to finish
 	_thread.join();
 
@@ -162,33 +75,115 @@ const Board& Analyzer::board() const noexcept
 	return _board;
 }
 
-void Analyzer::thread() noexcept
+int Analyzer::score() const noexcept
 {
-	setThreadName("Analyzer thread");
+	return _score;
+}
+
+uint64_t Analyzer::nodes() const noexcept
+{
+	return _nodes;
+}
+
+const SearchStats& Analyzer::stats() const noexcept
+{
+	return _stats;
+}
 
-	static constexpr size_t depth = 4;
+// Each thread votes for its best move, with the weight growing with its depth and with its score relative to the other threads.
+// A move found by several threads, or by a deeper one, beats one found by the main thread alone.
+static const SearchResult& voteForBestResult(const std::vector<SearchResult>& results) noexcept
+{
+	int minScore = ScoreInfinity;
+	for (const SearchResult& result : results)
+	{
+		if (!result.bestMove.isNull())
+			minScore = std::min(minScore, result.score);
+	}
 
-	Node tree;
-	Node* currentNode = &tree;
+	std::vector<std::pair<Move, int64_t>> votes;
+	const auto votesFor = [&votes](Move move) -> int64_t& {
+		const auto it = std::find_if(votes.begin(), votes.end(), [move](const auto& vote) { return vote.first == move; });
+		return it != votes.end() ? it->second : votes.emplace_back(move, 0).second;
+	};
 
-	generateMoveTree(_board, currentNode, depth);
-	calcMinMaxScore(currentNode, _board.sideToMove());
+	for (const SearchResult& result : results)
+	{
+		if (!result.bestMove.isNull())
+			votesFor(result.bestMove) += (int64_t)(result.score - minScore + 14) * (int64_t)result.depth;
+	}
 
-	uint8_t bestMoveIndex = 0;
-	
-	if (_board.sideToMove() == White)
+	const SearchResult* best = &results.front(); // The main thread, which always has a move if there is one
+	for (const SearchResult& result : results)
 	{
-		const auto best = std::ranges::max_element(tree.children, std::less{}, &Node::score);
-		bestMoveIndex = best->moveIndex;
+		if (!result.bestMove.isNull() && votesFor(result.bestMove) > votesFor(best->bestMove))
+			best = &result;
 	}
-	else
+
+	return *best;
+}
+
+void Analyzer::thread() noexcept
+{
+	setThreadName("Analyzer thread");
+
+	// The helper threads stop when the main one is done. Each search has its own board and stacks, only the transposition table is shared.
+	std::atomic<bool> helpersStopRequested = false;
+
+	// A node limit is for all the threads together, each one gets its share of it
+	const auto threadLimits = [this](size_t threadIndex) {
+		SearchLimits limits = _limits;
+		if (limits.nodes > 0)
+			limits.nodes = std::max(_limits.nodes / _threadCount + (threadIndex < _limits.nodes % _threadCount ? 1 : 0), uint64_t{ 1 });
+		return limits;
+	};
+
+	std::vector<std::unique_ptr<Search>> searches;
+	searches.push_back(std::make_unique<Search>(_board, threadLimits(0), &_tt, &_stopRequested));
+	for (size_t i = 1; i < _threadCount; ++i)
+		searches.push_back(std::make_unique<Search>(_board, threadLimits(i), &_tt, &helpersStopRequested, i));
+
+	std::vector<SearchResult> results(searches.size());
+	std::vector<std::thread> helpers;
+	for (size_t i = 1; i < searches.size(); ++i)
+	{
+		helpers.emplace_back([&, i] {
+			setThreadName("Search helper thread");
+			results[i] = searches[i]->run();
+		});
+	}
+
+	// The main thread reports on behalf of all of them
+	const auto reportInfo = [&](const SearchInfo& info) {
+		SearchInfo total = info;
+		total.nodes = 0;
+		for (const auto& search : searches)
+			total.nodes += search->nodes();
+
+		_onInfo(total);
+	};
+
+	results[0] = searches[0]->run(_onInfo ? SearchInfoCallback{ reportInfo } : SearchInfoCallback{});
+
+	helpersStopRequested = true;
+	for (auto& helper : helpers)
+		helper.join();
+
+	const SearchResult& result = voteForBestResult(results);
+	_bestMove = result.bestMove;
+	_score = result.score;
+	_nodes = 0;
+	_stats = {};
+	for (const SearchResult& r : results)
 	{
-		const auto best = std::ranges::min_element(tree.children, std::less{}, &Node::score);
-		bestMoveIndex = best->moveIndex;
+		_nodes += r.nodes;
+		_stats += r.stats;
 	}
 
-	MoveList moves;
-	_board.generateMoves(_board.sideToMove(), moves);
+	// An infinite search must not answer before "stop", even if it ran out of depth
+	while (_limits.infinite && !_stopRequested)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
-	_bestMove = moves[bestMoveIndex];
+	if (_onBestMove)
+		_onBestMove(_bestMove);
 }
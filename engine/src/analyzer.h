@@ -1,31 +1,64 @@
 #pragma once
 
 #include "board.h"
+#include "search.h"
+#include "transpositiontable.h"
 #include "threading/simplethread.h"
 
+#include <atomic>
+#include <functional>
 #include <vector>
 
 class Analyzer
 {
 public:
+	using BestMoveCallback = std::function<void(Move bestMove)>;
+
+	static constexpr size_t defaultHashSizeMb = 16;
+
 	Analyzer() noexcept;
 	~Analyzer() noexcept;
 
+	// Starts searching the current position in the background and returns immediately.
+	// Both callbacks are called from the search thread; onBestMove once the search is over, whether it stopped on its own or by stop().
+	void go(const SearchLimits& limits, SearchInfoCallback onInfo = {}, BestMoveCallback onBestMove = {}) noexcept;
+	// Stops the search, if there is one, and waits for it to finish
 	void stop() noexcept;
 
+	// Clears the transposition table, the next position is not related to the previous ones
 	void startNewGame() noexcept;
+	void setHashSize(size_t sizeMb) noexcept;
+	// The number of threads searching in parallel, sharing the transposition table
+	void setThreadCount(size_t threadCount) noexcept;
 	void setInitialPosition(const Board& initialPosition) noexcept;
-	[[nodiscard]] Move findBestMove() noexcept;
+	// Searches in the foreground
+	[[nodiscard]] Move findBestMove(const SearchLimits& limits) noexcept;
 	[[nodiscard]] const Board& board() const noexcept;
+	// The score of the last search in centipawns, from the point of view of the side to move
+	[[nodiscard]] int score() const noexcept;
+	// Positions visited by the last search, including the root
+	[[nodiscard]] uint64_t nodes() const noexcept;
+	// Of the last search, all the threads together
+	[[nodiscard]] const SearchStats& stats() const noexcept;
 
 private:
-	void start() noexcept;
 	void thread() noexcept;
 
 private:
 	std::vector<uint64_t> _previousPositionHashes; // Needed to detect repetitions, TODO: flat_set? Heap?
 
 	SimpleThread _thread;
+	std::atomic<bool> _stopRequested = false;
 	Board _board;
-	Move _bestMove = {0, 0, false, EmptySquare};
-};
\ No newline at end of file
+	TranspositionTable _tt{ defaultHashSizeMb };
+	size_t _threadCount = 1;
+
+	SearchLimits _limits;
+	SearchInfoCallback _onInfo;
+	BestMoveCallback _onBestMove;
+
+	Move _bestMove;
+	int _score = 0;
+	uint64_t _nodes = 0;
+	SearchStats _stats;
+};
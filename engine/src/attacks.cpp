@@ -0,0 +1,141 @@
+#include "attacks.h"
+#include "move_patterns.h"
+
+#include <assert.h>
+
+// Found offline with a sparse random search; one fixed shift per square ("fancy" magics with a shared table)
+inline constexpr Bitboard bishopMagicNumbers[64] {
+	0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+	0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+	0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+	0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+	0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+	0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+	0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+	0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+	0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+	0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+	0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+	0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+	0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+	0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+	0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+	0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL,
+};
+inline constexpr Bitboard rookMagicNumbers[64] {
+	0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+	0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+	0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+	0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+	0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+	0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+	0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+	0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+	0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+	0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+	0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+	0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+	0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+	0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+	0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+	0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL,
+};
+
+constexpr std::array<Bitboard, 64> knightAttackTable = [] {
+	std::array<Bitboard, 64> table {};
+	for (uint8_t square = 0; square < 64; ++square)
+		table[square] = leaperAttacks(square, knightMoves);
+	return table;
+}();
+
+constexpr std::array<Bitboard, 64> kingAttackTable = [] {
+	std::array<Bitboard, 64> table {};
+	for (uint8_t square = 0; square < 64; ++square)
+		table[square] = leaperAttacks(square, kingMoveVectors);
+	return table;
+}();
+
+constexpr std::array<std::array<Bitboard, 64>, 2> pawnAttackTable = [] {
+	const int blackPawnAttackVectors[2][2] {
+		{-pawnAttackVectors[0][0], pawnAttackVectors[0][1]},
+		{-pawnAttackVectors[1][0], pawnAttackVectors[1][1]}
+	};
+
+	std::array<std::array<Bitboard, 64>, 2> table {};
+	for (uint8_t square = 0; square < 64; ++square)
+	{
+		table[White][square] = leaperAttacks(square, pawnAttackVectors);
+		table[Black][square] = leaperAttacks(square, blackPawnAttackVectors);
+	}
+	return table;
+}();
+
+// The single ray from 'square' in the direction given by a {rank, file} step, blocked by 'occupied'
+static constexpr Bitboard ray(uint8_t square, Bitboard occupied, const int (&direction)[2]) noexcept
+{
+	const int directions[1][2] { { direction[0], direction[1] } };
+	return slidingAttacks(square, occupied, directions);
+}
+
+constexpr std::array<std::array<Bitboard, 64>, 64> betweenTable = [] {
+	std::array<std::array<Bitboard, 64>, 64> table {};
+	for (uint8_t a = 0; a < 64; ++a)
+	{
+		for (const auto& direction : kingMoveVectors)
+		{
+			// Walking from a towards b, the ray stops at b
+			const Bitboard emptyRay = ray(a, 0, direction);
+			for (Bitboard targets = emptyRay; targets; )
+			{
+				const uint8_t b = popLsb(targets);
+				table[a][b] = ray(a, squareBit(b), direction) & ~squareBit(b);
+			}
+		}
+	}
+	return table;
+}();
+
+std::array<SliderMagic, 64> bishopMagics;
+std::array<SliderMagic, 64> rookMagics;
+
+// The sum of 2^popcount(mask) over all squares
+static std::array<Bitboard, 5248> bishopAttackTable;
+static std::array<Bitboard, 102400> rookAttackTable;
+
+template <size_t N>
+static void initMagics(std::array<SliderMagic, 64>& magics, Bitboard* table, const Bitboard (&magicNumbers)[64], const int (&directions)[N][2]) noexcept
+{
+	size_t offset = 0;
+	for (uint8_t square = 0; square < 64; ++square)
+	{
+		// The edge squares never block a ray, so they are not part of the relevant occupancy
+		const Bitboard rankEdges = (Rank1 | Rank8) & ~(Rank1 << (8 * (square / 8)));
+		const Bitboard fileEdges = (FileA | FileH) & ~(FileA << (square % 8));
+
+		SliderMagic& m = magics[square];
+		m.mask = slidingAttacks(square, 0, directions) & ~(rankEdges | fileEdges);
+		m.magic = magicNumbers[square];
+		m.shift = static_cast<uint8_t>(64 - popCount(m.mask));
+		m.attacks = table + offset;
+
+		// Enumerate all subsets of the mask (Carry-Rippler)
+		Bitboard occupied = 0;
+		do
+		{
+			const size_t index = m.index(occupied);
+			const Bitboard attacks = slidingAttacks(square, occupied, directions);
+			assert(table[offset + index] == 0 || table[offset + index] == attacks); // Bad magic number
+			table[offset + index] = attacks;
+
+			occupied = (occupied - m.mask) & m.mask;
+		} while (occupied != 0);
+
+		offset += size_t{ 1 } << popCount(m.mask);
+	}
+}
+
+static const bool magicsInitialized = [] {
+	initMagics(bishopMagics, bishopAttackTable.data(), bishopMagicNumbers, bishopMoveVectors);
+	initMagics(rookMagics, rookAttackTable.data(), rookMagicNumbers, rookMoveVectors);
+	return true;
+}();
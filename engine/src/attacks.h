@@ -0,0 +1,78 @@
+#pragma once
+
+#include "bitboard.h"
+#include "piecetype.h"
+
+#include <array>
+#include <stddef.h>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// Magic bitboard lookup for the sliding pieces: the attack set for any occupancy is a single table read.
+// With BMI2 available at compile time, PEXT replaces the magic multiplication (the table layout is the same).
+struct SliderMagic
+{
+	Bitboard mask = 0; // Relevant occupancy: the rays from the square, board edges excluded
+	Bitboard magic = 0;
+	const Bitboard* attacks = nullptr;
+	uint8_t shift = 0;
+
+	[[nodiscard]] inline size_t index(Bitboard occupied) const noexcept {
+#if defined(__BMI2__)
+		return static_cast<size_t>(_pext_u64(occupied, mask));
+#else
+		return static_cast<size_t>(((occupied & mask) * magic) >> shift);
+#endif
+	}
+};
+
+// Filled once on startup, see attacks.cpp
+extern std::array<SliderMagic, 64> bishopMagics;
+extern std::array<SliderMagic, 64> rookMagics;
+
+[[nodiscard]] inline Bitboard bishopAttacks(uint8_t square, Bitboard occupied) noexcept
+{
+	const SliderMagic& m = bishopMagics[square];
+	return m.attacks[m.index(occupied)];
+}
+
+[[nodiscard]] inline Bitboard rookAttacks(uint8_t square, Bitboard occupied) noexcept
+{
+	const SliderMagic& m = rookMagics[square];
+	return m.attacks[m.index(occupied)];
+}
+
+[[nodiscard]] inline Bitboard queenAttacks(uint8_t square, Bitboard occupied) noexcept
+{
+	return bishopAttacks(square, occupied) | rookAttacks(square, occupied);
+}
+
+// Per-square tables, computed at compile time (see attacks.cpp)
+extern const std::array<Bitboard, 64> knightAttackTable;
+extern const std::array<Bitboard, 64> kingAttackTable;
+extern const std::array<std::array<Bitboard, 64>, 2> pawnAttackTable; // Indexed by Color, then by square
+extern const std::array<std::array<Bitboard, 64>, 64> betweenTable;
+
+[[nodiscard]] inline Bitboard knightAttacks(uint8_t square) noexcept
+{
+	return knightAttackTable[square];
+}
+
+[[nodiscard]] inline Bitboard kingAttacks(uint8_t square) noexcept
+{
+	return kingAttackTable[square];
+}
+
+// Squares attacked by a pawn of the given side standing on 'square'
+[[nodiscard]] inline Bitboard pawnAttacks(Color side, uint8_t square) noexcept
+{
+	return pawnAttackTable[side][square];
+}
+
+// Squares strictly between a and b if they share a rank, a file or a diagonal, otherwise 0
+[[nodiscard]] inline Bitboard squaresBetween(uint8_t a, uint8_t b) noexcept
+{
+	return betweenTable[a][b];
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "piecetype.h"
+
+#include <bit>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bit N corresponds to square N, i.e. bit 0 is a1, bit 7 is h1, bit 63 is h8
+using Bitboard = uint64_t;
+
+inline constexpr Bitboard FileA = 0x0101010101010101ULL;
+inline constexpr Bitboard FileB = FileA << 1;
+inline constexpr Bitboard FileG = FileA << 6;
+inline constexpr Bitboard FileH = FileA << 7;
+
+inline constexpr Bitboard Rank1 = 0xFFULL;
+inline constexpr Bitboard Rank2 = Rank1 << (8 * 1);
+inline constexpr Bitboard Rank7 = Rank1 << (8 * 6);
+inline constexpr Bitboard Rank8 = Rank1 << (8 * 7);
+
+[[nodiscard]] inline constexpr Bitboard squareBit(uint8_t square) noexcept
+{
+	return Bitboard{ 1 } << square;
+}
+
+[[nodiscard]] inline constexpr bool testBit(Bitboard b, uint8_t square) noexcept
+{
+	return (b & squareBit(square)) != 0;
+}
+
+// Index of the least significant set bit. b must not be empty.
+[[nodiscard]] inline constexpr uint8_t lsb(Bitboard b) noexcept
+{
+	return static_cast<uint8_t>(std::countr_zero(b));
+}
+
+// Clears the least significant set bit and returns its index. b must not be empty.
+inline constexpr uint8_t popLsb(Bitboard& b) noexcept
+{
+	const uint8_t square = lsb(b);
+	b &= b - 1;
+	return square;
+}
+
+[[nodiscard]] inline constexpr int popCount(Bitboard b) noexcept
+{
+	return std::popcount(b);
+}
+
+[[nodiscard]] inline constexpr bool hasMoreThanOne(Bitboard b) noexcept
+{
+	return (b & (b - 1)) != 0;
+}
+
+// Shifts all the bits by 'offset' squares (towards h8 for positive offsets)
+template <int offset>
+[[nodiscard]] inline constexpr Bitboard shift(Bitboard b) noexcept
+{
+	if constexpr (offset >= 0)
+		return b << offset;
+	else
+		return b >> -offset;
+}
+
+// Attacks of a piece that jumps by the given {rank, file} steps, the steps leading off the board are dropped
+template <size_t N>
+[[nodiscard]] inline constexpr Bitboard leaperAttacks(uint8_t square, const int (&steps)[N][2]) noexcept
+{
+	Bitboard attacks = 0;
+	for (const auto& step : steps)
+	{
+		const int rank = square / 8 + step[0];
+		const int file = square % 8 + step[1];
+		if (((rank | file) & ~0x07) == 0)
+			attacks |= squareBit(static_cast<uint8_t>(rank * 8 + file));
+	}
+
+	return attacks;
+}
+
+// Attacks along the given ray directions ({rank, file} steps), stopping at (and including) the first occupied square
+template <size_t N>
+[[nodiscard]] inline constexpr Bitboard slidingAttacks(uint8_t square, Bitboard occupied, const int (&directions)[N][2]) noexcept
+{
+	Bitboard attacks = 0;
+	for (const auto& direction : directions)
+	{
+		int rank = square / 8 + direction[0];
+		int file = square % 8 + direction[1];
+		while (((rank | file) & ~0x07) == 0)
+		{
+			const Bitboard target = squareBit(static_cast<uint8_t>(rank * 8 + file));
+			attacks |= target;
+			if (occupied & target)
+				break;
+
+			rank += direction[0];
+			file += direction[1];
+		}
+	}
+
+	return attacks;
+}
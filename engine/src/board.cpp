@@ -1,7 +1,9 @@
 #include "board.h"
+#include "attacks.h"
 #include "move_patterns.h"
-#include "hash/wheathash.hpp"
+#include "zobrist.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
@@ -16,11 +18,6 @@ inline constexpr uint8_t toSquare(int rank, int file) noexcept
 	return static_cast<uint8_t>(rank * 8 + file);
 }
 
-inline constexpr bool isValidSquare(int rank, int file)
-{
-	return ((rank | file) & (~0x07)) == 0;
-}
-
 static constexpr uint8_t whiteKingStart = toSquare(0, 4);  // e1
 static constexpr uint8_t blackKingStart = toSquare(7, 4);  // e8
 static constexpr uint8_t whiteKingsideRookStart = toSquare(0, 7);  // h1
@@ -28,49 +25,85 @@ static constexpr uint8_t whiteQueensideRookStart = toSquare(0, 0);  // a1
 static constexpr uint8_t blackKingsideRookStart = toSquare(7, 7);  // h8
 static constexpr uint8_t blackQueensideRookStart = toSquare(7, 0);  // a8
 
+// The castling rights that survive a move from or to each square
+static constexpr std::array<uint8_t, 64> castlingRightsMask = [] {
+	std::array<uint8_t, 64> mask;
+	mask.fill(WhiteKingSide | WhiteQueenSide | BlackKingSide | BlackQueenSide);
+	mask[whiteKingStart] &= ~(WhiteKingSide | WhiteQueenSide);
+	mask[blackKingStart] &= ~(BlackKingSide | BlackQueenSide);
+	mask[whiteKingsideRookStart] &= ~WhiteKingSide;
+	mask[whiteQueensideRookStart] &= ~WhiteQueenSide;
+	mask[blackKingsideRookStart] &= ~BlackKingSide;
+	mask[blackQueensideRookStart] &= ~BlackQueenSide;
+	return mask;
+}();
+
+// Everything about the pawn direction and the castling squares that depends on the side, resolved at compile time
+template <Color side>
+struct SideConstants
+{
+	static constexpr int pawnPush = pawnPushVectors[side][0] * 8;
+	// The rank a pawn lands on after a single push from its starting rank, i. e. the pawns that may push again
+	static constexpr Bitboard doublePushRank = Rank1 << (8 * (pawnStartRank[side] + pawnPushVectors[side][0]));
+	static constexpr Bitboard promotionRank = Rank1 << (8 * pawnPromotionRank[side]);
+
+	static constexpr uint8_t kingStart = toSquare(backRank[side], 4);
+	static constexpr uint8_t kingSideRookStart = toSquare(backRank[side], 7);
+	static constexpr uint8_t queenSideRookStart = toSquare(backRank[side], 0);
+	static constexpr uint8_t kingSideKingTarget = toSquare(backRank[side], 6);
+	static constexpr uint8_t kingSideRookTarget = toSquare(backRank[side], 5);
+	static constexpr uint8_t queenSideKingTarget = toSquare(backRank[side], 2);
+	static constexpr uint8_t queenSideRookTarget = toSquare(backRank[side], 3);
+	static constexpr uint8_t kingSideCastlingRight = side == White ? WhiteKingSide : BlackKingSide;
+	static constexpr uint8_t queenSideCastlingRight = side == White ? WhiteQueenSide : BlackQueenSide;
+	// The squares that must be empty for castling
+	static constexpr Bitboard kingSidePath = squareBit(kingSideRookTarget) | squareBit(kingSideKingTarget);
+	static constexpr Bitboard queenSidePath = squareBit(queenSideRookTarget) | squareBit(queenSideKingTarget) | squareBit(queenSideRookStart + 1);
+	// The squares that must not be attacked: the king can't castle out of, through or into check
+	static constexpr Bitboard kingSideKingPath = squareBit(kingStart) | squareBit(kingSideRookTarget) | squareBit(kingSideKingTarget);
+	static constexpr Bitboard queenSideKingPath = squareBit(kingStart) | squareBit(queenSideRookTarget) | squareBit(queenSideKingTarget);
+};
+
 Board& Board::setToStartingPosition() noexcept
 {
 	// Set up the initial piece arrangement on the board
 	// Assuming White pieces are in the lower ranks and Black pieces in the upper ranks
+	clear();
 
-	_castlingRights = WhiteKingSide | WhiteQueenSide | BlackKingSide | BlackQueenSide;
-	_enPassantSquare = 0;
+	setCastlingRights(WhiteKingSide | WhiteQueenSide | BlackKingSide | BlackQueenSide);
 
 	// Pawns
-	for (int file = 0; file < 8; ++file)
+	for (uint8_t file = 0; file < 8; ++file)
 	{
-		_squares[toSquare(1, file)] = Piece(PieceType::Pawn, Color::White);
-		_squares[toSquare(6, file)] = Piece(PieceType::Pawn, Color::Black);
+		set(1, file, Piece(PieceType::Pawn, Color::White));
+		set(6, file, Piece(PieceType::Pawn, Color::Black));
 	}
 
 	// Rooks
-	_squares[toSquare(0, 0)] = Piece(PieceType::Rook, Color::White);
-	_squares[toSquare(0, 7)] = Piece(PieceType::Rook, Color::White);
-	_squares[toSquare(7, 0)] = Piece(PieceType::Rook, Color::Black);
-	_squares[toSquare(7, 7)] = Piece(PieceType::Rook, Color::Black);
+	set(0, 0, Piece(PieceType::Rook, Color::White));
+	set(0, 7, Piece(PieceType::Rook, Color::White));
+	set(7, 0, Piece(PieceType::Rook, Color::Black));
+	set(7, 7, Piece(PieceType::Rook, Color::Black));
 
 	// Knights
-	_squares[toSquare(0, 1)] = Piece(PieceType::Knight, Color::White);
-	_squares[toSquare(0, 6)] = Piece(PieceType::Knight, Color::White);
-	_squares[toSquare(7, 1)] = Piece(PieceType::Knight, Color::Black);
-	_squares[toSquare(7, 6)] = Piece(PieceType::Knight, Color::Black);
+	set(0, 1, Piece(PieceType::Knight, Color::White));
+	set(0, 6, Piece(PieceType::Knight, Color::White));
+	set(7, 1, Piece(PieceType::Knight, Color::Black));
+	set(7, 6, Piece(PieceType::Knight, Color::Black));
 
 	// Bishops
-	_squares[toSquare(0, 2)] = Piece(PieceType::Bishop, Color::White);
-	_squares[toSquare(0, 5)] = Piece(PieceType::Bishop, Color::White);
-	_squares[toSquare(7, 2)] = Piece(PieceType::Bishop, Color::Black);
-	_squares[toSquare(7, 5)] = Piece(PieceType::Bishop, Color::Black);
+	set(0, 2, Piece(PieceType::Bishop, Color::White));
+	set(0, 5, Piece(PieceType::Bishop, Color::White));
+	set(7, 2, Piece(PieceType::Bishop, Color::Black));
+	set(7, 5, Piece(PieceType::Bishop, Color::Black));
 
 	// Queens
-	_squares[toSquare(0, 3)] = Piece(PieceType::Queen, Color::White);
-	_squares[toSquare(7, 3)] = Piece(PieceType::Queen, Color::Black);
-
-	// Kings
-	_squares[toSquare(0, 4)] = Piece(PieceType::King, Color::White);
-	_squares[toSquare(7, 4)] = Piece(PieceType::King, Color::Black);
+	set(0, 3, Piece(PieceType::Queen, Color::White));
+	set(7, 3, Piece(PieceType::Queen, Color::Black));
 
-	_wKingSquare = toSquare(0, 4);
-	_bKingSquare = toSquare(7, 4);
+	// Kings (also sets _wKingSquare and _bKingSquare)
+	set(0, 4, Piece(PieceType::King, Color::White));
+	set(7, 4, Piece(PieceType::King, Color::Black));
 
 	return *this;
 }
@@ -78,230 +111,457 @@ Board& Board::setToStartingPosition() noexcept
 void Board::clear() noexcept
 {
 	_squares.fill(Piece{});
+	_typeBB.fill(0);
+	_colorBB.fill(0);
 	_enPassantSquare = 0;
 	_sideToMove = Color::White;
 	_castlingRights = 0;
+	_hash = 0;
+	_pawnHash = 0;
+	_attackedSquaresValid = 0;
 }
 
-// Generates all pseudo-legal moves
 void Board::generateMoves(Color side, MoveList& moves) const noexcept
 {
-	for (uint8_t i = 0; i < 64; ++i)
+	if (side == White)
+		generateMoves<White>(moves);
+	else
+		generateMoves<Black>(moves);
+}
+
+// Generates all pseudo-legal moves
+template <Color side>
+void Board::generateMoves(MoveList& moves) const noexcept
+{
+	const Bitboard targets = ~pieces(side);
+
+	generatePawnMoves<side, AllMoves>(pieces(Pawn, side), targets, moves);
+	generatePieceMoves<side, Knight>(pieces(Knight, side), targets, moves);
+	generatePieceMoves<side, Bishop>(pieces(Bishop, side), targets, moves);
+	generatePieceMoves<side, Rook>(pieces(Rook, side), targets, moves);
+	generatePieceMoves<side, Queen>(pieces(Queen, side), targets, moves);
+	generatePieceMoves<side, King>(pieces(King, side), targets, moves);
+	generateEnPassantMoves<side, false>(moves);
+	generateCastlingMoves<side>(moves);
+}
+
+void Board::generateLegalMoves(MoveList& moves, Bitboard targetMask) const noexcept
+{
+	if (_sideToMove == White)
+		generateLegalMoves<White>(moves, targetMask);
+	else
+		generateLegalMoves<Black>(moves, targetMask);
+}
+
+void Board::generateCaptures(MoveList& moves) const noexcept
+{
+	if (_sideToMove == White)
+		generateLegalMoves<White, NoisyMoves>(moves);
+	else
+		generateLegalMoves<Black, NoisyMoves>(moves);
+}
+
+void Board::generateQuietMoves(MoveList& moves) const noexcept
+{
+	if (_sideToMove == White)
+		generateLegalMoves<White, QuietMoves>(moves);
+	else
+		generateLegalMoves<Black, QuietMoves>(moves);
+}
+
+// Generates only the legal moves for the side to move.
+// Checkers and pinned pieces are found once, then every piece is restricted to the squares it may legally reach.
+template <Color side, MoveGenType type>
+void Board::generateLegalMoves(MoveList& moves, const Bitboard targetMask) const noexcept
+{
+	assert(side == _sideToMove);
+
+	const uint8_t kingSquare = this->kingSquare(side);
+	const Bitboard own = pieces(side);
+	const Bitboard enemies = pieces(oppositeSide(side));
+	const Bitboard occupiedSquares = own | enemies;
+	// The destination squares for the given move type. Pawns filter their moves themselves: a promotion is noisy even on an empty square.
+	const Bitboard typeMask = type == NoisyMoves ? enemies : (type == QuietMoves ? ~occupiedSquares : ~Bitboard{ 0 });
+
+	// King moves. The attack map is built without the king, otherwise stepping back along a checking ray would look safe.
+	for (Bitboard targets = kingAttacks(kingSquare) & ~own & ~attackedSquares(oppositeSide(side)) & targetMask & typeMask; targets; )
 	{
-		const Piece movingPiece = _squares[i];
-		const auto type = movingPiece.type();
-		if (type == EmptySquare || movingPiece.color() != side)
+		const uint8_t to = popLsb(targets);
+		moves.emplace_back(kingSquare, to, testBit(enemies, to) ? CaptureMove : QuietMove);
+	}
+
+	const Bitboard checkers = attackersTo(kingSquare, occupiedSquares) & enemies;
+	if (hasMoreThanOne(checkers)) [[unlikely]] // Double check - only the king can move
+		return;
+
+	// In check, the other pieces can only capture the checker or block the checking ray
+	const Bitboard checkMask = checkers != 0 ? (squaresBetween(kingSquare, lsb(checkers)) | checkers) : ~Bitboard{ 0 };
+	const Bitboard pawnTargets = ~own & checkMask & targetMask;
+	const Bitboard targets = pawnTargets & typeMask;
+
+	// A pinned piece can only move along the ray between the king and the pinner, including capturing the pinner.
+	// The pinned pieces are handled right here, one by one; a pinned knight can never move.
+	Bitboard pinned = 0;
+	const Bitboard queens = pieces(Queen);
+	const Bitboard snipers = enemies & (
+		(rookAttacks(kingSquare, enemies) & (pieces(Rook) | queens)) |
+		(bishopAttacks(kingSquare, enemies) & (pieces(Bishop) | queens)));
+
+	for (Bitboard s = snipers; s; )
+	{
+		const uint8_t sniper = popLsb(s);
+		const Bitboard ray = squaresBetween(kingSquare, sniper);
+		const Bitboard blockers = ray & occupiedSquares;
+		if ((blockers & own) == 0 || hasMoreThanOne(blockers))
 			continue;
 
-		switch (type)
+		pinned |= blockers;
+		const Bitboard pinRay = ray | squareBit(sniper);
+		const Bitboard pinTargets = targets & pinRay;
+		switch (_squares[lsb(blockers)].type())
 		{
 		case Pawn:
-			generatePawnMoves(i, moves);
-			break;
-		case Knight:
-			generateKnightMoves(i, moves);
+			generatePawnMoves<side, type>(blockers, pawnTargets & pinRay, moves);
 			break;
 		case Bishop:
-			generateBishopMoves(i, moves);
+			generatePieceMoves<side, Bishop>(blockers, pinTargets, moves);
 			break;
 		case Rook:
-			generateRookMoves(i, moves);
+			generatePieceMoves<side, Rook>(blockers, pinTargets, moves);
 			break;
 		case Queen:
-			generateQueenMoves(i, moves);
-			break;
-		case King:
-			generateKingMoves(i, moves);
+			generatePieceMoves<side, Queen>(blockers, pinTargets, moves);
 			break;
 		default:
 			break;
 		}
 	}
 
-	generateCastlingMoves(moves, side);
+	const Bitboard free = ~pinned;
+	generatePawnMoves<side, type>(pieces(Pawn, side) & free, pawnTargets, moves);
+	generatePieceMoves<side, Knight>(pieces(Knight, side) & free, targets, moves);
+	generatePieceMoves<side, Bishop>(pieces(Bishop, side) & free, targets, moves);
+	generatePieceMoves<side, Rook>(pieces(Rook, side) & free, targets, moves);
+	generatePieceMoves<side, Queen>(pieces(Queen, side) & free, targets, moves);
+
+	if constexpr (type != QuietMoves)
+	{
+		if (testBit(targetMask, _enPassantSquare))
+			generateEnPassantMoves<side, true>(moves);
+	}
+
+	if constexpr (type != NoisyMoves)
+	{
+		using Side = SideConstants<side>;
+		if (checkers == 0 && (targetMask & (squareBit(Side::kingSideKingTarget) | squareBit(Side::queenSideKingTarget))) != 0)
+			generateCastlingMoves<side>(moves);
+	}
+}
+
+bool Board::isLegal(const Move move) const noexcept
+{
+	const Color side = _sideToMove;
+	const uint8_t from = move.from(), to = move.to();
+	if (move.isNull() || !testBit(pieces(side), from))
+		return false;
+
+	// Rare enough not to be worth the special cases: only the moves to the same square are generated
+	if (move.isCastling() || move.isEnPassant()) [[unlikely]]
+	{
+		MoveList moves;
+		generateLegalMoves(moves, squareBit(to));
+		return std::find(moves.begin(), moves.end(), move) != moves.end();
+	}
+
+	// The move kind must be the one the generator would have given it: a capture for an enemy piece on the target, a quiet move for an empty square
+	const Bitboard enemies = pieces(oppositeSide(side));
+	const Bitboard occupiedSquares = occupied();
+	if (move.isCapture() ? !testBit(enemies, to) || pieceAt(to).type() == King : testBit(occupiedSquares, to))
+		return false;
+
+	const PieceType type = pieceAt(from).type();
+	if (type == Pawn)
+	{
+		const int forward = side == White ? 8 : -8;
+		const bool lastRank = testBit(Rank1 | Rank8, to);
+		if (move.isPromotion() != lastRank)
+			return false;
+		if (!move.isPromotion() && move.kind() != QuietMove && move.kind() != DoublePawnPush && move.kind() != CaptureMove)
+			return false;
+
+		if (move.isCapture())
+		{
+			if (!testBit(pawnAttacks(side, from), to))
+				return false;
+		}
+		else if (move.kind() == DoublePawnPush)
+		{
+			const Bitboard startRank = side == White ? Rank2 : Rank7;
+			if (!testBit(startRank, from) || to != from + 2 * forward || testBit(occupiedSquares, static_cast<uint8_t>(from + forward)))
+				return false;
+		}
+		else if (to != from + forward)
+			return false;
+	}
+	else
+	{
+		if (move.kind() != QuietMove && move.kind() != CaptureMove)
+			return false;
+
+		Bitboard attacks = 0;
+		switch (type)
+		{
+		case Knight: attacks = knightAttacks(from); break;
+		case Bishop: attacks = bishopAttacks(from, occupiedSquares); break;
+		case Rook: attacks = rookAttacks(from, occupiedSquares); break;
+		case Queen: attacks = queenAttacks(from, occupiedSquares); break;
+		case King: attacks = kingAttacks(from); break;
+		default: break;
+		}
+
+		if (!testBit(attacks, to))
+			return false;
+	}
+
+	// The own king must not be left in check, which covers both the pins and the check evasions. A captured piece no longer attacks.
+	const uint8_t king = type == King ? to : kingSquare(side);
+	const Bitboard occupiedAfter = (occupiedSquares ^ squareBit(from)) | squareBit(to);
+	return (attackersTo(king, occupiedAfter) & enemies & ~squareBit(to)) == 0;
 }
 
 void Board::set(uint8_t rank, uint8_t file, Piece piece) noexcept
 {
-	_squares[toSquare(rank, file)] = piece;
+	const uint8_t square = toSquare(rank, file);
+	if (_squares[square].type() != EmptySquare)
+		removePiece(square);
+
+	if (piece.type() != EmptySquare)
+		putPiece(square, piece);
+}
+
+template <bool updateHash>
+void Board::putPiece(uint8_t square, Piece piece) noexcept
+{
+	assert(_squares[square].type() == EmptySquare);
+
+	_attackedSquaresValid = 0;
+	_squares[square] = piece;
+	_typeBB[piece.type()] |= squareBit(square);
+	_colorBB[piece.color()] |= squareBit(square);
+
+	if constexpr (updateHash)
+	{
+		const uint64_t key = zobrist.pieces[piece.id()][square];
+		_hash ^= key;
+		if (piece.type() == Pawn)
+			_pawnHash ^= key;
+	}
+
 	if (piece.type() == King) [[unlikely]]
 	{
 		if (piece.color() == Color::White)
-			_wKingSquare = toSquare(rank, file);
+			_wKingSquare = square;
 		else
-			_bKingSquare = toSquare(rank, file);
+			_bKingSquare = square;
+	}
+}
+
+template <bool updateHash>
+void Board::removePiece(uint8_t square) noexcept
+{
+	const Piece piece = _squares[square];
+	assert(piece.type() != EmptySquare);
+
+	_attackedSquaresValid = 0;
+	_typeBB[piece.type()] &= ~squareBit(square);
+	_colorBB[piece.color()] &= ~squareBit(square);
+	_squares[square] = Piece{};
+
+	if constexpr (updateHash)
+	{
+		const uint64_t key = zobrist.pieces[piece.id()][square];
+		_hash ^= key;
+		if (piece.type() == Pawn)
+			_pawnHash ^= key;
+	}
+}
+
+template <bool updateHash>
+void Board::movePiece(uint8_t from, uint8_t to) noexcept
+{
+	const Piece piece = _squares[from];
+	assert(piece.type() != EmptySquare && _squares[to].type() == EmptySquare);
+
+	_attackedSquaresValid = 0;
+	const Bitboard fromTo = squareBit(from) | squareBit(to);
+	_typeBB[piece.type()] ^= fromTo;
+	_colorBB[piece.color()] ^= fromTo;
+	_squares[from] = Piece{};
+	_squares[to] = piece;
+
+	if constexpr (updateHash)
+	{
+		const uint64_t key = zobrist.pieces[piece.id()][from] ^ zobrist.pieces[piece.id()][to];
+		_hash ^= key;
+		if (piece.type() == Pawn)
+			_pawnHash ^= key;
+	}
+
+	if (piece.type() == King) [[unlikely]]
+	{
+		if (piece.color() == Color::White)
+			_wKingSquare = to;
+		else
+			_bKingSquare = to;
 	}
 }
 
 void Board::setEnPassantSquare(uint8_t square) noexcept
 {
+	if (_enPassantSquare != 0)
+		_hash ^= zobrist.enPassantFile[_enPassantSquare % 8];
+	if (square != 0)
+		_hash ^= zobrist.enPassantFile[square % 8];
+
 	_enPassantSquare = square;
 }
 
 void Board::setSideToMove(Color side) noexcept
 {
+	if (side != _sideToMove)
+		_hash ^= zobrist.blackToMove;
+
 	_sideToMove = side;
 }
 
 void Board::setCastlingRights(uint8_t rights) noexcept
 {
+	_hash ^= zobrist.castlingRights[_castlingRights] ^ zobrist.castlingRights[rights];
 	_castlingRights = rights;
 }
 
-// Returns false if the move is illegal (the moving piece is pinned)
-bool Board::applyMove(const Move move) noexcept
+Board::RollbackInfo Board::applyMove(const Move move) noexcept
 {
-	const Piece movingPiece = _squares[move.from()];
+	return _sideToMove == White ? applyMove<White>(move) : applyMove<Black>(move);
+}
 
-	const auto currentEnPassantSquare = _enPassantSquare;
-	_enPassantSquare = 0;
-	_sideToMove = oppositeSide(_sideToMove); // Always flipping side to move so that rollback has to simply always flip it back
+template <Color side>
+Board::RollbackInfo Board::applyMove(const Move move) noexcept
+{
+	assert(side == _sideToMove);
+	using Side = SideConstants<side>;
 
-	// Handle castling moves
-	if (movingPiece.type() == King)
-	{
-		// TODO: convert to switch
-		if (movingPiece.color() == Color::White)
-			_wKingSquare = move.to();
-		else
-			_bKingSquare = move.to();
+	const uint8_t from = move.from();
+	const uint8_t to = move.to();
+	const RollbackInfo rollbackInfo{ _hash, _pawnHash, _squares[to], _castlingRights, _enPassantSquare };
 
-		if (move.from() == whiteKingStart && move.to() == toSquare(0, 6)) // White king side castling
-		{
-			// Move the rook (king will be moved by the normal path)
-			_squares[toSquare(0, 5)] = Piece(PieceType::Rook, Color::White);
-			_squares[toSquare(0, 7)] = Piece{};
-			_castlingRights &= ~(WhiteKingSide | WhiteQueenSide);
-		}
-		else if (move.from() == blackKingStart && move.to() == toSquare(7, 6)) // Black king side castling
-		{
-			// Move the rook (king will be moved by the normal path)
-			_squares[toSquare(7, 5)] = Piece(PieceType::Rook, Color::Black);
-			_squares[toSquare(7, 7)] = Piece{};
-			_castlingRights &= ~(BlackKingSide | BlackQueenSide);
-		}
-		else if (move.from() == whiteKingStart && move.to() == toSquare(0, 2)) // White queen side castling
-		{
-			// Move the rook (king will be moved by the normal path)
-			_squares[toSquare(0, 3)] = Piece(PieceType::Rook, Color::White);
-			_squares[toSquare(0, 0)] = Piece{};
-			_castlingRights &= ~(WhiteKingSide | WhiteQueenSide);
-		}
-		else if (move.from() == blackKingStart && move.to() == toSquare(7, 2)) // Black queen side castling
-		{
-			// Move the rook (king will be moved by the normal path)
-			_squares[toSquare(7, 3)] = Piece(PieceType::Rook, Color::Black);
-			_squares[toSquare(7, 0)] = Piece{};
-			_castlingRights &= ~(BlackKingSide | BlackQueenSide);
-		}
-		else
-		{
-			// King moved - no more castling
-			const uint8_t mask = movingPiece.color() == Color::White ? (~(WhiteKingSide | WhiteQueenSide)) : ~(BlackKingSide | BlackQueenSide);
-			_castlingRights &= mask;
-		}
-	}
-	else if (movingPiece.type() == Rook)
-	{
-		// Handle castling rights
-		// TODO: switch
-		if (move.from() == whiteKingsideRookStart)
-			_castlingRights &= ~WhiteKingSide;
-		else if (move.from() == whiteQueensideRookStart)
-			_castlingRights &= ~WhiteQueenSide;
-		else if (move.from() == blackKingsideRookStart)
-			_castlingRights &= ~BlackKingSide;
-		else if (move.from() == blackQueensideRookStart)
-			_castlingRights &= ~BlackQueenSide;
-	}
+	if (_enPassantSquare != 0)
+		_hash ^= zobrist.enPassantFile[_enPassantSquare % 8];
 
-	_squares[move.from()] = Piece{};
-	_squares[move.to()] = movingPiece;
+	_enPassantSquare = 0;
+	_sideToMove = oppositeSide(side); // Always flipping side to move so that rollback has to simply always flip it back
+	_hash ^= zobrist.blackToMove;
 
-	if (movingPiece.type() == Pawn)
+	switch (move.kind())
 	{
-		// Handle en passant availability
-		const int diff = (int)move.to() - (int)move.from();
-		if (diff == 2 * 8 || diff == -2 * 8) // Double pawn push
-		{
-			_enPassantSquare = static_cast<uint8_t>(move.to() - (diff / 2)); // The square behind the pawn
-		}
-		else if (currentEnPassantSquare != 0 && move.to() == currentEnPassantSquare) // En passant capture - remove the captured pawn
-		{
-			// The captured pawn was on the same rank as move.from() and same file as move.to()
-			_squares[toSquare(move.from() / 8, move.to() % 8)] = Piece{};
-		}
-		else if (move.promotion() != EmptySquare) [[unlikely]]
-		{
-			// Handle promotion
-			_squares[move.to()] = Piece{ move.promotion(), movingPiece.color() };
-		}
+	case QuietMove:
+		movePiece(from, to);
+		break;
+	case DoublePawnPush:
+		movePiece(from, to);
+		_enPassantSquare = static_cast<uint8_t>(to - Side::pawnPush); // The square behind the pawn
+		_hash ^= zobrist.enPassantFile[_enPassantSquare % 8];
+		break;
+	case KingSideCastle:
+		movePiece(from, to);
+		movePiece(Side::kingSideRookStart, Side::kingSideRookTarget);
+		break;
+	case QueenSideCastle:
+		movePiece(from, to);
+		movePiece(Side::queenSideRookStart, Side::queenSideRookTarget);
+		break;
+	case CaptureMove:
+		removePiece(to);
+		movePiece(from, to);
+		break;
+	case EnPassantCapture:
+		removePiece(static_cast<uint8_t>(to - Side::pawnPush));
+		movePiece(from, to);
+		break;
+	default: // Promotions
+		if (move.isCapture())
+			removePiece(to);
+		removePiece(from);
+		putPiece(to, Piece{ move.promotion(), side });
+		break;
 	}
 
-	if (isInCheck(movingPiece.color())) [[unlikely]]
-		return false;
+	// Moving the king or a rook off its starting square, or capturing a rook on it, drops the corresponding rights
+	const uint8_t castlingRights = _castlingRights & castlingRightsMask[from] & castlingRightsMask[to];
+	if (castlingRights != _castlingRights)
+	{
+		_hash ^= zobrist.castlingRights[_castlingRights] ^ zobrist.castlingRights[castlingRights];
+		_castlingRights = castlingRights;
+	}
 
-	return true;
+	assert(hashIsValid());
+	return rollbackInfo;
 }
 
 void Board::rollbackMove(const Move& move, const RollbackInfo& rollbackInfo) noexcept
 {
-	const Piece movingPiece = _squares[move.to()];
-	_squares[move.from()] = movingPiece;
-	_squares[move.to()] = rollbackInfo.targetPiece;
+	// The side that made the move is the one not to move now
+	if (_sideToMove == Black)
+		rollbackMove<White>(move, rollbackInfo);
+	else
+		rollbackMove<Black>(move, rollbackInfo);
+}
 
-	_sideToMove = oppositeSide(_sideToMove);
+template <Color side>
+void Board::rollbackMove(const Move& move, const RollbackInfo& rollbackInfo) noexcept
+{
+	assert(side != _sideToMove);
+	using Side = SideConstants<side>;
 
-	_wKingSquare = rollbackInfo.wKingSquare;
-	_bKingSquare = rollbackInfo.bKingSquare;
-	_castlingRights = rollbackInfo.castlingRights;
-	_enPassantSquare = rollbackInfo.enPassantSquare;
+	const uint8_t from = move.from();
+	const uint8_t to = move.to();
+	_sideToMove = side;
 
-	// Castling Rollback
-	if (movingPiece.type() == PieceType::King) [[unlikely]]
+	switch (move.kind())
 	{
-		// White queen-side castling
-		if (move.from() == whiteKingStart && move.to() == toSquare(0, 2))
-		{
-			_squares[whiteQueensideRookStart] = Piece{Rook, White};
-			_squares[toSquare(0, 3)] = Piece{};
-		}
-		// White king-side castling
-		else if (move.from() == whiteKingStart && move.to() == toSquare(0, 6))
-		{
-			_squares[whiteKingsideRookStart] = Piece{Rook, White};
-			_squares[toSquare(0, 5)] = Piece{};
-		}
-		// Black queen-side castling
-		else if (move.from() == blackKingStart && move.to() == toSquare(7, 2))
-		{
-			_squares[blackQueensideRookStart] = Piece{Rook, Black};
-			_squares[toSquare(7, 3)] = Piece{};
-		}
-		// Black king-side castling
-		else if (move.from() == blackKingStart && move.to() == toSquare(7, 6))
-		{
-			_squares[blackKingsideRookStart] = Piece{Rook, Black};
-			_squares[toSquare(7, 5)] = Piece{};
-		}
+	case QuietMove:
+	case DoublePawnPush:
+		movePiece<false>(to, from);
+		break;
+	case KingSideCastle:
+		movePiece<false>(to, from);
+		movePiece<false>(Side::kingSideRookTarget, Side::kingSideRookStart);
+		break;
+	case QueenSideCastle:
+		movePiece<false>(to, from);
+		movePiece<false>(Side::queenSideRookTarget, Side::queenSideRookStart);
+		break;
+	case CaptureMove:
+		movePiece<false>(to, from);
+		putPiece<false>(to, rollbackInfo.targetPiece);
+		break;
+	case EnPassantCapture:
+		movePiece<false>(to, from);
+		putPiece<false>(static_cast<uint8_t>(to - Side::pawnPush), Piece{ Pawn, oppositeSide(side) });
+		break;
+	default: // Promotions
+		removePiece<false>(to);
+		putPiece<false>(from, Piece{ Pawn, side });
+		if (move.isCapture())
+			putPiece<false>(to, rollbackInfo.targetPiece);
+		break;
 	}
-	// En Passant Rollback
-	else if (move.isCapture() && rollbackInfo.targetPiece.type() == EmptySquare) [[unlikely]]
-	{
-		// Determine direction based on the moving piece's color
-		const int direction = (movingPiece.color() == White) ? -1 : 1;
 
-		// Calculate the square where the captured pawn must be restored
-		const int capturedPawnSquare = toSquare((move.to() / 8) + direction, move.to() % 8);
-
-		// Restore the captured pawn (it's the opposite color of the moving piece)
-		_squares[capturedPawnSquare] = Piece{ Pawn, oppositeSide(movingPiece.color()) };
-	}
-	else if (move.promotion() != EmptySquare) [[unlikely]]
-	{
-		// Promotion Rollback
-		_squares[move.from()] = Piece{ Pawn, movingPiece.color() };
-	}
+	_castlingRights = rollbackInfo.castlingRights;
+	_enPassantSquare = rollbackInfo.enPassantSquare;
+	_hash = rollbackInfo.hash;
+	_pawnHash = rollbackInfo.pawnHash;
+	assert(hashIsValid());
 }
 
 Piece Board::pieceAt(uint8_t square) const noexcept
@@ -345,513 +605,307 @@ bool Board::isEnemyPiece(uint8_t square, Color mySide) const noexcept
 	return piece.type() != EmptySquare && piece.color() != mySide;
 }
 
-uint64_t Board::hash() const noexcept
+uint64_t Board::computeHash() const noexcept
 {
-	uint64_t hash = wheathash64(_squares.data(), _squares.size() * sizeof(Piece));
-	hash ^= wheathash64v(((uint64_t)_castlingRights << 16) | ((uint64_t)_enPassantSquare << 8) | (uint64_t)_sideToMove);
+	uint64_t hash = 0;
+	for (Bitboard occupiedSquares = occupied(); occupiedSquares; )
+	{
+		const uint8_t square = popLsb(occupiedSquares);
+		hash ^= zobrist.pieces[_squares[square].id()][square];
+	}
+
+	hash ^= zobrist.castlingRights[_castlingRights];
+	if (_enPassantSquare != 0)
+		hash ^= zobrist.enPassantFile[_enPassantSquare % 8];
+	if (_sideToMove == Black)
+		hash ^= zobrist.blackToMove;
+
 	return hash;
 }
 
-
-void Board::generatePawnMoves(uint8_t square, MoveList &moves) const noexcept
+uint64_t Board::computePawnHash() const noexcept
 {
-	// TODO: pass 'side' from the caller
-	const Color side = _squares[square].color();
-	const int rank = square / 8;
-	const int file = square % 8;
-
-	// Pawn push
-	const int advance = (side == White) ? 1 : -1;
-	const int targetRank = rank + advance;
-	const int promotionRank = (side == White) ? 7 : 0;
-
-	if (isValidSquare(targetRank, file) && isEmptySquare(targetRank, file))
+	uint64_t pawnHash = 0;
+	for (Bitboard pawns = pieces(Pawn); pawns; )
 	{
-		if (targetRank == promotionRank) [[unlikely]]
-		{
-			// Generate promotion moves (Queen, Rook, Bishop, Knight)
-			moves.emplace_back(square, toSquare(targetRank, file), false, Queen);
-			moves.emplace_back(square, toSquare(targetRank, file), false, Rook);
-			moves.emplace_back(square, toSquare(targetRank, file), false, Bishop);
-			moves.emplace_back(square, toSquare(targetRank, file), false, Knight);
-		}
-		else
-			moves.emplace_back(square, toSquare(targetRank, file));
+		const uint8_t square = popLsb(pawns);
+		pawnHash ^= zobrist.pieces[_squares[square].id()][square];
 	}
 
-	// Double pawn push
-	const int doubleForward = (side == White && rank == 1) || (side == Black && rank == 6) ? advance * 2 : 0;
-	if (doubleForward != 0 && isEmptySquare(rank + doubleForward, file) && isEmptySquare(targetRank, file))
-	{
-		moves.emplace_back(square, toSquare(rank + doubleForward, file));
-	}
+	return pawnHash;
+}
 
-	// Pawn captures
-	const int leftCapture = file - 1;
-	const int rightCapture = file + 1;
+bool Board::hashIsValid() const noexcept
+{
+	return computeHash() == _hash && computePawnHash() == _pawnHash;
+}
 
-	for (auto captureFile : { leftCapture, rightCapture })
-	{
-		if (isValidSquare(targetRank, captureFile) && isEnemyPiece(targetRank, captureFile, side))
-		{
-			if (targetRank == promotionRank) [[unlikely]]
-			{
-				// Generate promotion moves (Queen, Rook, Bishop, Knight)
-				moves.emplace_back(square, toSquare(targetRank, captureFile), true, Queen);
-				moves.emplace_back(square, toSquare(targetRank, captureFile), true, Rook);
-				moves.emplace_back(square, toSquare(targetRank, captureFile), true, Bishop);
-				moves.emplace_back(square, toSquare(targetRank, captureFile), true, Knight);
-			}
-			else
-				moves.emplace_back(square, toSquare(targetRank, captureFile), true);
-		}
-	}
 
-	if (_enPassantSquare != 0)
+// Adds a move from 'from' to every square in 'targets', flagging captures of the enemy pieces
+static void addMoves(uint8_t from, Bitboard targets, Bitboard enemies, MoveList& moves) noexcept
+{
+	while (targets)
 	{
-		const int enPassantRank = _enPassantSquare / 8;
-		const int enPassantFile = _enPassantSquare % 8;
-
-		if ((rank == enPassantRank - advance) && (leftCapture == enPassantFile || rightCapture == enPassantFile))
-		{
-			moves.emplace_back(square, _enPassantSquare, true);
-		}
+		const uint8_t to = popLsb(targets);
+		moves.emplace_back(from, to, testBit(enemies, to) ? CaptureMove : QuietMove);
 	}
 }
 
-void Board::generateKnightMoves(uint8_t square, MoveList &moves) const noexcept
+// Adds all four promotions of the pawn move 'from'-'to' (Queen, Rook, Bishop, Knight)
+static void addPromotions(uint8_t from, uint8_t to, bool capture, MoveList& moves) noexcept
 {
-	const Color side = _squares[square].color();
-	const int rank = square / 8;
-	const int file = square % 8;
-
-	for (size_t i = 0; i < 8; ++i)
-	{
-		const int targetRank = rank + knightMoves[i][0];
-		const int targetFile = file + knightMoves[i][1];
-
-		if (isValidSquare(targetRank, targetFile))
-		{
-			const bool capture = isEnemyPiece(targetRank, targetFile, side);
-			if (capture || isEmptySquare(targetRank, targetFile))
-			{
-				moves.emplace_back(square, toSquare(targetRank, targetFile), capture);
-			}
-		}
-	}
+	moves.emplace_back(from, to, promotionKind(Queen, capture));
+	moves.emplace_back(from, to, promotionKind(Rook, capture));
+	moves.emplace_back(from, to, promotionKind(Bishop, capture));
+	moves.emplace_back(from, to, promotionKind(Knight, capture));
 }
 
-void Board::generateBishopMoves(uint8_t square, MoveList &moves) const noexcept
+// Moves of all the given pawns at once; en passant is generated separately
+template <Color side, MoveGenType type>
+void Board::generatePawnMoves(Bitboard pawns, Bitboard targets, MoveList& moves) const noexcept
 {
-	const Color side = _squares[square].color();
-	const int rank = square / 8;
-	const int file = square % 8;
+	using Side = SideConstants<side>;
+	constexpr int push = Side::pawnPush;
+
+	const Bitboard empty = ~occupied();
+	const Bitboard enemies = pieces(oppositeSide(side)) & targets;
 
-	for (size_t i = 0; i < 4; ++i)
+	// The double push is checked against 'targets' separately, since it may block a check even when the single push doesn't
+	const Bitboard singlePushes = shift<push>(pawns) & empty;
+	const Bitboard doublePushes = shift<push>(singlePushes & Side::doublePushRank) & empty & targets;
+	const Bitboard pushes = singlePushes & targets;
+	// Captures towards the a-file and towards the h-file
+	const Bitboard capturesWest = shift<push - 1>(pawns & ~FileA) & enemies;
+	const Bitboard capturesEast = shift<push + 1>(pawns & ~FileH) & enemies;
+
+	if constexpr (type != NoisyMoves)
 	{
-		for (int j = 1; j < 8; ++j)
+		for (Bitboard b = pushes & ~Side::promotionRank; b; )
 		{
-			const int targetRank = rank + j * bishopMoveVectors[i][0];
-			const int targetFile = file + j * bishopMoveVectors[i][1];
-
-			if (!isValidSquare(targetRank, targetFile))
-				break; // Stop if the target square is out of bounds
-
-			if (isEmptySquare(targetRank, targetFile))
-				moves.emplace_back(square, toSquare(targetRank, targetFile));
-			else
-			{
-				if (isEnemyPiece(targetRank, targetFile, side))
-				{
-					moves.emplace_back(square, toSquare(targetRank, targetFile), true);
-				}
-
-				break; // Stop if a piece is encountered (captures beyond it are not possible)
-			}
+			const uint8_t to = popLsb(b);
+			moves.emplace_back(static_cast<uint8_t>(to - push), to);
 		}
-	}
-}
-
-void Board::generateRookMoves(uint8_t square, MoveList &moves) const noexcept
-{
-	const Color side = _squares[square].color();
-	const int rank = square / 8;
-	const int file = square % 8;
 
-	for (size_t i = 0; i < 4; ++i)
-	{
-		for (int j = 1; j < 8; ++j)
+		for (Bitboard b = doublePushes; b; )
 		{
-			const int targetRank = rank + j * rookMoveVectors[i][0];
-			const int targetFile = file + j * rookMoveVectors[i][1];
-
-			if (!isValidSquare(targetRank, targetFile))
-				break; // Stop if the target square is out of bounds
-
-			if (isEmptySquare(targetRank, targetFile))
-				moves.emplace_back(square, toSquare(targetRank, targetFile));
-			else
-			{
-				if (isEnemyPiece(targetRank, targetFile, side))
-				{
-					moves.emplace_back(square, toSquare(targetRank, targetFile), true);
-				}
-
-				break; // Stop if a piece is encountered (captures beyond it are not possible)
-			}
+			const uint8_t to = popLsb(b);
+			moves.emplace_back(static_cast<uint8_t>(to - 2 * push), to, DoublePawnPush);
 		}
 	}
-}
 
-void Board::generateQueenMoves(uint8_t square, MoveList &moves) const noexcept
-{
-	generateRookMoves(square, moves);
-	generateBishopMoves(square, moves);
-}
+	if constexpr (type == QuietMoves)
+		return;
 
-void Board::generateKingMoves(uint8_t square, MoveList &moves) const noexcept
-{
-	const Color side = _squares[square].color();
-	const int rank = square / 8;
-	const int file = square % 8;
+	for (Bitboard b = capturesWest & ~Side::promotionRank; b; )
+	{
+		const uint8_t to = popLsb(b);
+		moves.emplace_back(static_cast<uint8_t>(to - (push - 1)), to, CaptureMove);
+	}
 
-	const auto generateMoves = [&](auto movePattern)
+	for (Bitboard b = capturesEast & ~Side::promotionRank; b; )
 	{
-		const int targetRank = rank + movePattern[0];
-		const int targetFile = file + movePattern[1];
+		const uint8_t to = popLsb(b);
+		moves.emplace_back(static_cast<uint8_t>(to - (push + 1)), to, CaptureMove);
+	}
 
-		if (isValidSquare(targetRank, targetFile))
-		{
-			const Piece target = _squares[toSquare(targetRank, targetFile)];
-			if (target.type() == EmptySquare || target.color() != side)
-			{
-				const bool capture = target.type() != EmptySquare;
-				moves.emplace_back(square, toSquare(targetRank, targetFile), capture);
-			}
-		}
-	};
+	if ((pawns & shift<-push>(Side::promotionRank)) == 0) [[likely]]
+		return;
 
-	for (const auto move : bishopMoveVectors)
-		generateMoves(move);
+	for (Bitboard b = pushes & Side::promotionRank; b; )
+	{
+		const uint8_t to = popLsb(b);
+		addPromotions(static_cast<uint8_t>(to - push), to, false, moves);
+	}
+
+	for (Bitboard b = capturesWest & Side::promotionRank; b; )
+	{
+		const uint8_t to = popLsb(b);
+		addPromotions(static_cast<uint8_t>(to - (push - 1)), to, true, moves);
+	}
 
-	for (const auto move : rookMoveVectors)
-		generateMoves(move);
+	for (Bitboard b = capturesEast & Side::promotionRank; b; )
+	{
+		const uint8_t to = popLsb(b);
+		addPromotions(static_cast<uint8_t>(to - (push + 1)), to, true, moves);
+	}
 }
 
-void Board::generateCastlingMoves(MoveList& moves, Color side) const noexcept
+// Moves of all the given pieces of one type (anything but pawns)
+template <Color side, PieceType type>
+void Board::generatePieceMoves(Bitboard movers, Bitboard targets, MoveList& moves) const noexcept
 {
-	if (side == White)
-	{
-		// The rook check is necessary because it might have been captured
-		if ((_castlingRights & WhiteKingSide) && _squares[whiteKingsideRookStart] == Piece{PieceType::Rook, Color::White})
-		{
-			// Check if squares f1 and g1 are empty and the king isn't in check
-			if (isEmptySquare(0, 5) && isEmptySquare(0, 6) &&
-				!isSquareAttacked(0, 4, Black) && !isSquareAttacked(0, 5, Black) && !isSquareAttacked(0, 6, Black))
-			{
-				moves.emplace_back(whiteKingStart, toSquare(0, 6));  // Kingside castling
-			}
-		}
+	const Bitboard occupiedSquares = occupied();
+	const Bitboard enemies = pieces(oppositeSide(side));
 
-		if ((_castlingRights & WhiteQueenSide) && _squares[whiteQueensideRookStart] == Piece{ PieceType::Rook, Color::White })
-		{
-			// Check if squares b1, c1, and d1 are empty and the king isn't in check
-			if (isEmptySquare(0, 1) && isEmptySquare(0, 2) && isEmptySquare(0, 3) &&
-				!isSquareAttacked(0, 4, Black) && !isSquareAttacked(0, 3, Black) && !isSquareAttacked(0, 2, Black))
-			{
-				moves.emplace_back(whiteKingStart, toSquare(0, 2));  // Queenside castling
-			}
-		}
-	}
-	else
+	while (movers)
 	{
-		if ((_castlingRights & BlackKingSide) && _squares[blackKingsideRookStart] == Piece{ PieceType::Rook, Color::Black })
+		const uint8_t from = popLsb(movers);
+		Bitboard attacks;
+		if constexpr (type == Knight)
+			attacks = knightAttacks(from);
+		else if constexpr (type == Bishop)
+			attacks = bishopAttacks(from, occupiedSquares);
+		else if constexpr (type == Rook)
+			attacks = rookAttacks(from, occupiedSquares);
+		else if constexpr (type == Queen)
+			attacks = queenAttacks(from, occupiedSquares);
+		else
 		{
-			// Check if squares f8 and g8 are empty and the king isn't in check
-			if (isEmptySquare(7, 5) && isEmptySquare(7, 6) &&
-				!isSquareAttacked(7, 4, White) && !isSquareAttacked(7, 5, White) && !isSquareAttacked(7, 6, White))
-			{
-				moves.emplace_back(blackKingStart, toSquare(7, 6));  // Kingside castling
-			}
+			static_assert(type == King);
+			attacks = kingAttacks(from);
 		}
 
-		if ((_castlingRights & BlackQueenSide) && _squares[blackQueensideRookStart] == Piece{ PieceType::Rook, Color::Black })
-		{
-			// Check if squares b8, c8, and d8 are empty and the king isn't in check
-			if (isEmptySquare(7, 1) && isEmptySquare(7, 2) && isEmptySquare(7, 3) &&
-				!isSquareAttacked(7, 4, White) && !isSquareAttacked(7, 3, White) && !isSquareAttacked(7, 2, White))
-			{
-				moves.emplace_back(blackKingStart, toSquare(7, 2));  // Queenside castling
-			}
-		}
+		addMoves(from, attacks & targets, enemies, moves);
 	}
 }
 
-bool Board::isSquareAttacked(int rank, int file, Color attackingSide) const noexcept
+template <Color side>
+void Board::generateCastlingMoves(MoveList& moves) const noexcept
 {
-	// Check for pawn attacks
-	const int pawnAdvance = (attackingSide == White) ? -1 : 1;
-	if (isValidSquare(rank + pawnAdvance, file - 1) && _squares[toSquare(rank + pawnAdvance, file - 1)].type() == Pawn &&
-		_squares[toSquare(rank + pawnAdvance, file - 1)].color() == attackingSide)
-		return true;
+	using Side = SideConstants<side>;
+	if ((_castlingRights & (Side::kingSideCastlingRight | Side::queenSideCastlingRight)) == 0) [[likely]]
+		return;
 
-	if (isValidSquare(rank + pawnAdvance, file + 1) && _squares[toSquare(rank + pawnAdvance, file + 1)].type() == Pawn &&
-		_squares[toSquare(rank + pawnAdvance, file + 1)].color() == attackingSide)
-		return true;
+	const Bitboard occupiedSquares = occupied();
+	const Bitboard attacked = attackedSquares(oppositeSide(side));
 
-	// Check for knight attacks
-	for (const auto& offset : knightMoves)
+	// The rook check is necessary because it might have been captured
+	if ((_castlingRights & Side::kingSideCastlingRight) && _squares[Side::kingSideRookStart] == Piece{ Rook, side } &&
+		(occupiedSquares & Side::kingSidePath) == 0 && (attacked & Side::kingSideKingPath) == 0)
 	{
-		int targetRank = rank + offset[0];
-		int targetFile = file + offset[1];
-		if (isValidSquare(targetRank, targetFile) &&
-			_squares[toSquare(targetRank, targetFile)].type() == Knight &&
-			_squares[toSquare(targetRank, targetFile)].color() == attackingSide)
-			return true;
+		moves.emplace_back(Side::kingStart, Side::kingSideKingTarget, KingSideCastle);
 	}
 
-	static constexpr int kingOffsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
-										  {0, 1}, {1, -1}, {1, 0}, {1, 1} };
-
-	// Check for king attacks
-	for (const auto& offset : kingOffsets)
+	if ((_castlingRights & Side::queenSideCastlingRight) && _squares[Side::queenSideRookStart] == Piece{ Rook, side } &&
+		(occupiedSquares & Side::queenSidePath) == 0 && (attacked & Side::queenSideKingPath) == 0)
 	{
-		int targetRank = rank + offset[0];
-		int targetFile = file + offset[1];
-		if (isValidSquare(targetRank, targetFile) &&
-			_squares[toSquare(targetRank, targetFile)].type() == King &&
-			_squares[toSquare(targetRank, targetFile)].color() == attackingSide)
-			return true;
+		moves.emplace_back(Side::kingStart, Side::queenSideKingTarget, QueenSideCastle);
 	}
+}
 
-	// General sliding attacks (bishop/rook/queen)
-	// Combine diagonal (bishop/queen) and straight-line (rook/queen) into a single sliding loop
-	static constexpr std::pair<int, int> directions[] {
-		{-1, -1}, {-1, 1}, {1, -1}, {1, 1},  // Diagonal directions
-		{-1, 0}, {1, 0}, {0, -1}, {0, 1}     // Straight-line directions
-	};
+template <Color side, bool legalOnly>
+void Board::generateEnPassantMoves(MoveList& moves) const noexcept
+{
+	if (_enPassantSquare == 0)
+		return;
 
-	for (const auto& dir : directions)
+	// The pawns that could capture onto the en passant square are the ones it "attacks" as a pawn of the opposite color
+	const Bitboard target = squareBit(_enPassantSquare);
+	const uint8_t capturedPawnSquare = static_cast<uint8_t>(_enPassantSquare - SideConstants<side>::pawnPush);
+	for (Bitboard pawns = pawnAttacks(oppositeSide(side), _enPassantSquare) & pieces(Pawn, side); pawns; )
 	{
-		int targetRank = rank + dir.first;
-		int targetFile = file + dir.second;
-		while (isValidSquare(targetRank, targetFile))
+		const uint8_t from = popLsb(pawns);
+		if constexpr (legalOnly)
 		{
-			const auto piece = _squares[toSquare(targetRank, targetFile)];
-			const auto pieceType = piece.type();
-			const auto pieceColor = piece.color();
-
-			if (pieceType != EmptySquare)
-			{
-				if (pieceColor == attackingSide &&
-					((pieceType == Bishop && (dir.first != 0 && dir.second != 0)) ||  // Diagonal attack (bishop)
-					 (pieceType == Rook && (dir.first == 0 || dir.second == 0))   ||   // Straight-line attack (rook)
-					  pieceType == Queen))                                           // Queen can attack both diagonally and straight
-				{
-					return true;
-				}
-
-				break;  // Stop further sliding in this direction if blocked
-			}
-
-			targetRank += dir.first;
-			targetFile += dir.second;
+			// Two pawns leave their rank at once, which can expose the king along it; simply test the resulting position.
+			// This also handles check evasion and ordinary pins.
+			const Bitboard occupiedAfter = (occupied() ^ squareBit(from) ^ squareBit(capturedPawnSquare)) | target;
+			if (attackersTo(kingSquare(side), occupiedAfter) & pieces(oppositeSide(side)) & ~squareBit(capturedPawnSquare))
+				continue;
 		}
-	}
 
-	// No attack detected
-	return false;
+		moves.emplace_back(from, _enPassantSquare, EnPassantCapture);
+	}
 }
 
-bool Board::isInCheck(const Color side) const noexcept
+bool Board::isSquareAttacked(uint8_t square, Color attackingSide) const noexcept
 {
-	const int kingIndex = side == White ? _wKingSquare : _bKingSquare;
-	const int enemyKingIndex = side == White ? _bKingSquare : _wKingSquare;
-	
-	const int kingRank = kingIndex / 8;
-	const int kingFile = kingIndex % 8;
-
-	const int enemyKingRank = enemyKingIndex / 8;
-	const int enemyKingFile = enemyKingIndex % 8;
+	const Bitboard attackers = pieces(attackingSide);
 
-	if (abs(kingRank - enemyKingRank) <= 1 && abs(kingFile - enemyKingFile) <= 1) [[unlikely]]
+	// A square is attacked by a pawn if a pawn of the opposite color standing on it would attack that pawn
+	if (pawnAttacks(oppositeSide(attackingSide), square) & pieces(Pawn) & attackers)
 		return true;
 
-	for (const auto move : rookMoveVectors)
-	{
-		for (int i = 1;; ++i)
-		{
-			const int newRank = kingRank + i * move[0];
-			const int newFile = kingFile + i * move[1];
-			if (!isValidSquare(newRank, newFile))
-				break;
-
-			const auto piece = _squares[toSquare(newRank, newFile)];
-			const PieceType type = piece.type();
-			if ((type == PieceType::Rook || type == PieceType::Queen) && piece.color() != side) [[unlikely]]
-				return true;
-			else if (type != PieceType::EmptySquare)
-				break;
-		}
-	}
+	if (knightAttacks(square) & pieces(Knight) & attackers)
+		return true;
 
-	for (const auto move : bishopMoveVectors)
-	{
-		for (int i = 1;; ++i)
-		{
-			const int newRank = kingRank + i * move[0];
-			const int newFile = kingFile + i * move[1];
-			if (!isValidSquare(newRank, newFile))
-				break;
-
-			const auto piece = _squares[toSquare(newRank, newFile)];
-			const PieceType type = piece.type();
-			if ((type == PieceType::Bishop || type == PieceType::Queen) && piece.color() != side) [[unlikely]]
-				return true;
-			else if (type != PieceType::EmptySquare)
-				break;
-		}
-	}
+	if (kingAttacks(square) & pieces(King) & attackers)
+		return true;
 
-	for (const auto move : knightMoves)
-	{
-		const int newRank = kingRank + move[0];
-		const int newFile = kingFile + move[1];
-		if (isValidSquare(newRank, newFile) && _squares[toSquare(newRank, newFile)] == Piece{ Knight, oppositeSide(side) }) [[unlikely]]
-			return true;
-	}
+	// Sliding attacks (bishop/rook/queen)
+	const Bitboard queens = pieces(Queen);
+	const Bitboard occupiedSquares = occupied();
+	if (bishopAttacks(square, occupiedSquares) & (pieces(Bishop) | queens) & attackers)
+		return true;
 
-	for (const auto move : pawnAttackVectors)
-	{
-		const auto attackerSide = oppositeSide(side);
-		const int newRank = kingRank - (move[0] * attackerSide == White ? 1 : -1);
-		const int newFile = kingFile - move[1];
-		if (isValidSquare(newRank, newFile) &&
-			_squares[toSquare(newRank, newFile)] == Piece{ Pawn, attackerSide }) [[unlikely]]
-			return true;
-	}
+	if (rookAttacks(square, occupiedSquares) & (pieces(Rook) | queens) & attackers)
+		return true;
 
+	// No attack detected
 	return false;
 }
 
-bool Board::isInCheck(const Color side, const Move& move) const noexcept
+Bitboard Board::attackersTo(uint8_t square, Bitboard occupiedSquares) const noexcept
 {
-	const int kingIndex = (side == White) ? _wKingSquare : _bKingSquare;
-
-	// Full check needed if the king itself moved
-	if (move.to() == kingIndex)
-		return isInCheck(side);
-
-	const int kingRank = kingIndex / 8;
-	const int kingFile = kingIndex % 8;
-	const Color attackerSide = oppositeSide(side);
+	const Bitboard queens = pieces(Queen);
+
+	return (pawnAttacks(Black, square) & pieces(Pawn, White)) |
+		(pawnAttacks(White, square) & pieces(Pawn, Black)) |
+		(knightAttacks(square) & pieces(Knight)) |
+		(kingAttacks(square) & pieces(King)) |
+		(bishopAttacks(square, occupiedSquares) & (pieces(Bishop) | queens)) |
+		(rookAttacks(square, occupiedSquares) & (pieces(Rook) | queens));
+}
 
-	// Calculate ranks and files of from/to squares
-	const int fromRank = move.from() / 8;
-	const int fromFile = move.from() % 8;
-	const int toRank = move.to() / 8;
-	const int toFile = move.to() % 8;
+bool Board::isInCheck(const Color side) const noexcept
+{
+	// The attack map is reused if the move generator has built it already, but it's not worth building just for this test
+	const Color enemy = oppositeSide(side);
+	if (_attackedSquaresValid & (1u << enemy))
+		return testBit(_attackedSquares[enemy], kingSquare(side));
 
-	// Calculate directional steps from king to moved piece (if in line)
-	const int stepRank = (fromRank == kingRank) ? 0 : (fromRank > kingRank ? 1 : -1);
-	const int stepFile = (fromFile == kingFile) ? 0 : (fromFile > kingFile ? 1 : -1);
+	return isSquareAttacked(kingSquare(side), enemy);
+}
 
-	// Check if the piece was shielding the king along a potential attack line.
-	if ((stepRank == 0 || stepFile == 0 || abs(stepRank) == abs(stepFile)) &&
-		(kingRank + stepRank == fromRank && kingFile + stepFile == fromFile))
+Bitboard Board::attackedSquares(const Color side) const noexcept
+{
+	if ((_attackedSquaresValid & (1u << side)) == 0)
 	{
-		// Move along this attack line to see if the threat continues past the "to" square
-		int rank = fromRank + stepRank;
-		int file = fromFile + stepFile;
-
-		while (rank != toRank || file != toFile)
-		{
-			Piece piece = _squares[toSquare(rank, file)];
-			if (piece.type() == PieceType::Rook || piece.type() == PieceType::Queen ||
-				piece.type() == PieceType::Bishop)
-			{
-				if (piece.color() == attackerSide)
-					return true; // A discovered check along the attack vector
-				break; // Blocked by a friendly piece or non-attacking piece
-			}
-			if (piece.type() != PieceType::EmptySquare)
-				break;
-			rank += stepRank;
-			file += stepFile;
-		}
+		_attackedSquares[side] = side == White ? computeAttackedSquares<White>() : computeAttackedSquares<Black>();
+		_attackedSquaresValid |= static_cast<uint8_t>(1u << side);
 	}
 
-	// Check attack lines originating at the "to" square for new threats to the king.
-	for (const auto& vector : rookMoveVectors)
-	{
-		int rank = toRank + vector[0];
-		int file = toFile + vector[1];
+	return _attackedSquares[side];
+}
 
-		while (isValidSquare(rank, file))
-		{
-			Piece piece = _squares[toSquare(rank, file)];
-			if (piece.color() == attackerSide &&
-				(piece.type() == PieceType::Rook || piece.type() == PieceType::Queen))
-			{
-				if (rank == kingRank && file == kingFile)
-					return true;
-				break;
-			}
-			if (piece.type() != PieceType::EmptySquare)
-				break;
-			rank += vector[0];
-			file += vector[1];
-		}
-	}
+template <Color side>
+Bitboard Board::computeAttackedSquares() const noexcept
+{
+	constexpr int push = SideConstants<side>::pawnPush;
+	const Bitboard pawns = pieces(Pawn, side);
+	Bitboard attacked = shift<push - 1>(pawns & ~FileA) | shift<push + 1>(pawns & ~FileH);
 
-	// Repeat for bishop moves for potential new diagonal threats
-	for (const auto& vector : bishopMoveVectors)
-	{
-		int rank = toRank + vector[0];
-		int file = toFile + vector[1];
+	for (Bitboard knights = pieces(Knight, side); knights; )
+		attacked |= knightAttacks(popLsb(knights));
 
-		while (isValidSquare(rank, file))
-		{
-			Piece piece = _squares[toSquare(rank, file)];
-			if (piece.color() == attackerSide &&
-				(piece.type() == PieceType::Bishop || piece.type() == PieceType::Queen))
-			{
-				if (rank == kingRank && file == kingFile)
-					return true;
-				break;
-			}
-			if (piece.type() != PieceType::EmptySquare)
-				break;
-			rank += vector[0];
-			file += vector[1];
-		}
-	}
+	const Bitboard occupiedSquares = occupied() ^ pieces(King, oppositeSide(side));
+	const Bitboard queens = pieces(Queen, side);
+	for (Bitboard bishops = pieces(Bishop, side) | queens; bishops; )
+		attacked |= bishopAttacks(popLsb(bishops), occupiedSquares);
 
-	// Check for knight attacks from `to` square
-	for (const auto& vector : knightMoves)
-	{
-		int rank = toRank + vector[0];
-		int file = toFile + vector[1];
-		if (isValidSquare(rank, file) &&
-			_squares[toSquare(rank, file)] == Piece{ PieceType::Knight, attackerSide })
-		{
-			if (rank == kingRank && file == kingFile)
-				return true;
-		}
-	}
+	for (Bitboard rooks = pieces(Rook, side) | queens; rooks; )
+		attacked |= rookAttacks(popLsb(rooks), occupiedSquares);
 
-	// Check for pawn attacks on the king from the `to` square
-	const int pawnDirection = (attackerSide == White) ? -1 : 1;
-	for (int fileOffset : {-1, 1})
-	{
-		int rank = kingRank + pawnDirection;
-		int file = kingFile + fileOffset;
-		if (isValidSquare(rank, file) &&
-			_squares[toSquare(rank, file)] == Piece{ PieceType::Pawn, attackerSide })
-		{
-			return true;
-		}
-	}
+	return attacked | kingAttacks(kingSquare(side));
+}
 
-	return false;
+bool Board::operator==(const Board& other) const noexcept
+{
+	return _squares == other._squares && _typeBB == other._typeBB && _colorBB == other._colorBB &&
+		_enPassantSquare == other._enPassantSquare && _sideToMove == other._sideToMove && _castlingRights == other._castlingRights &&
+		_wKingSquare == other._wKingSquare && _bKingSquare == other._bKingSquare &&
+		_hash == other._hash && _pawnHash == other._pawnHash;
 }
+
+template void Board::generateMoves<White>(MoveList&) const noexcept;
+template void Board::generateMoves<Black>(MoveList&) const noexcept;
+template void Board::generateLegalMoves<White, AllMoves>(MoveList&, Bitboard) const noexcept;
+template void Board::generateLegalMoves<Black, AllMoves>(MoveList&, Bitboard) const noexcept;
+template void Board::generateLegalMoves<White, NoisyMoves>(MoveList&, Bitboard) const noexcept;
+template void Board::generateLegalMoves<Black, NoisyMoves>(MoveList&, Bitboard) const noexcept;
+template void Board::generateLegalMoves<White, QuietMoves>(MoveList&, Bitboard) const noexcept;
+template void Board::generateLegalMoves<Black, QuietMoves>(MoveList&, Bitboard) const noexcept;
+template Board::RollbackInfo Board::applyMove<White>(Move) noexcept;
+template Board::RollbackInfo Board::applyMove<Black>(Move) noexcept;
+template void Board::rollbackMove<White>(const Move&, const RollbackInfo&) noexcept;
+template void Board::rollbackMove<Black>(const Move&, const RollbackInfo&) noexcept;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bitboard.h"
 #include "move.h"
 #include "piece.h"
 
@@ -12,6 +13,13 @@ enum CastlingRights : uint8_t {
 	BlackQueenSide = 8
 };
 
+// Which moves a generator emits. Promotions count as noisy even without a capture.
+enum MoveGenType : uint8_t {
+	AllMoves,
+	NoisyMoves, // Captures (including en passant) and promotions
+	QuietMoves  // Everything else, castling included
+};
+
 struct MoveList
 {
 	template <typename... Args>
@@ -27,6 +35,10 @@ struct MoveList
 		return _moves.begin() + _count;
 	}
 
+	inline constexpr void clear() noexcept {
+		_count = 0;
+	}
+
 	[[nodiscard]] inline constexpr auto count() const noexcept {
 		return _count;
 	}
@@ -35,39 +47,70 @@ struct MoveList
 		return _moves[index];
 	}
 
+	[[nodiscard]] inline constexpr Move& operator[](uint8_t index) noexcept {
+		return _moves[index];
+	}
+
+	static constexpr size_t capacity = 127;
+
 private:
-	std::array<Move, 127> _moves; // *Probably* should be enough?
+	std::array<Move, capacity> _moves; // *Probably* should be enough?
 	uint8_t _count = 0;
 };
 
 class Board
 {
 public:
+	// The state applyMove() can't derive back from the move itself
 	struct RollbackInfo {
+		uint64_t hash;
+		uint64_t pawnHash;
 		Piece targetPiece;
-		uint8_t wKingSquare;
-		uint8_t bKingSquare;
 		uint8_t castlingRights;
 		uint8_t enPassantSquare;
-		bool succeded = false;
 	};
 
 	Board& setToStartingPosition() noexcept;
 	void clear() noexcept;
 
-	// Generates all pseudo-legal moves
+	// Generates all pseudo-legal moves. The caller has to check isInCheck() after applying each one.
 	void generateMoves(Color side, MoveList& moves) const noexcept;
+	template <Color side>
+	void generateMoves(MoveList& moves) const noexcept;
+	// Generates only the legal moves for the side to move.
+	// 'targetMask' limits the destination squares, which allows generating e. g. the captures and the quiet moves separately.
+	void generateLegalMoves(MoveList& moves, Bitboard targetMask = ~Bitboard{ 0 }) const noexcept;
+	template <Color side, MoveGenType type = AllMoves> // 'side' must be the side to move
+	void generateLegalMoves(MoveList& moves, Bitboard targetMask = ~Bitboard{ 0 }) const noexcept;
+	// Only the legal captures and promotions, for the tactical search; much cheaper than the full generation
+	void generateCaptures(MoveList& moves) const noexcept;
+	// The legal moves generateCaptures() leaves out
+	void generateQuietMoves(MoveList& moves) const noexcept;
+
+	// For moves that may come from a different position, like the hash move or the killer moves. Checks the move directly, without generating the moves.
+	[[nodiscard]] bool isLegal(Move move) const noexcept;
+
 	void set(uint8_t rank, uint8_t file, Piece piece) noexcept;
 	void setEnPassantSquare(uint8_t square) noexcept;
 	void setSideToMove(Color side) noexcept;
 	void setCastlingRights(uint8_t rights) noexcept;
 
-	// Returns false if the move is illegal (the moving piece is pinned)
-	[[nodiscard]] bool applyMove(Move move) noexcept;
+	// The move must be legal, or the caller must check isInCheck() afterwards (for pseudo-legal moves).
+	// Returns the info for undoing the move with rollbackMove().
+	RollbackInfo applyMove(Move move) noexcept;
+	void rollbackMove(const Move& move, const RollbackInfo& rollbackInfo) noexcept;
+	// The side-specific versions skip the runtime dispatch; 'side' is the side making the move
+	template <Color side>
+	RollbackInfo applyMove(Move move) noexcept;
+	template <Color side>
 	void rollbackMove(const Move& move, const RollbackInfo& rollbackInfo) noexcept;
 
 	[[nodiscard]] bool isInCheck(Color side) const noexcept;
-	[[nodiscard]] bool isInCheck(const Color side, const Move& move) const noexcept;
+	// Squares attacked by 'side'. The other side's king is taken off the board for this, so that it can't shield a square behind itself on a checking ray.
+	// Computed on demand and cached until the position changes (which also means a const Board must not be shared between threads).
+	[[nodiscard]] Bitboard attackedSquares(Color side) const noexcept;
+	// Pieces of both colors attacking the square, given the occupancy. Pieces taken off 'occupiedSquares' still count as attackers, the caller has to mask them out.
+	[[nodiscard]] Bitboard attackersTo(uint8_t square, Bitboard occupiedSquares) const noexcept;
 
 	[[nodiscard]] Piece pieceAt(uint8_t square) const noexcept;
 	[[nodiscard]] Piece pieceAt(int rank, int file) const noexcept;
@@ -76,32 +119,70 @@ public:
 	[[nodiscard]] uint8_t enPassantSquare() const noexcept;
 	[[nodiscard]] uint8_t castlingRights() const noexcept;
 
+	[[nodiscard]] inline Bitboard pieces(PieceType type) const noexcept { return _typeBB[type]; }
+	[[nodiscard]] inline Bitboard pieces(Color side) const noexcept { return _colorBB[side]; }
+	[[nodiscard]] inline Bitboard pieces(PieceType type, Color side) const noexcept { return _typeBB[type] & _colorBB[side]; }
+	[[nodiscard]] inline Bitboard occupied() const noexcept { return _colorBB[White] | _colorBB[Black]; }
+
 	[[nodiscard]] bool isEmptySquare(int rank, int file) const noexcept;
 	[[nodiscard]] bool isEnemyPiece(int rank, int file, Color mySide) const noexcept;
 	[[nodiscard]] bool isEnemyPiece(uint8_t square, Color mySide) const noexcept;
 
-	[[nodiscard]] uint64_t hash() const noexcept;
+	// Zobrist keys, maintained incrementally
+	[[nodiscard]] inline uint64_t hash() const noexcept { return _hash; }
+	[[nodiscard]] inline uint64_t pawnHash() const noexcept { return _pawnHash; }
+	// The same keys computed from scratch, as they would have to be without the incremental updates
+	[[nodiscard]] uint64_t computeHash() const noexcept;
+	[[nodiscard]] uint64_t computePawnHash() const noexcept;
 
-	[[nodiscard]] bool operator==(const Board&) const = default;
+	// Compares the position, the attack map cache is not a part of it
+	[[nodiscard]] bool operator==(const Board& other) const noexcept;
 
 private:
-	void generatePawnMoves(uint8_t square, MoveList&moves) const noexcept;
-	void generateKnightMoves(uint8_t square, MoveList& moves) const noexcept;
-	void generateBishopMoves(uint8_t square, MoveList& moves) const noexcept;
-	void generateRookMoves(uint8_t square, MoveList& moves) const noexcept;
-	void generateQueenMoves(uint8_t square, MoveList& moves) const noexcept;
-	void generateKingMoves(uint8_t square, MoveList& moves) const noexcept;
-	void generateCastlingMoves(MoveList& moves, Color side) const noexcept;
-
-	[[nodiscard]] bool isSquareAttacked(int rank, int file, Color attackingSide) const noexcept;
+	// 'targets' restricts the destination squares (used for check evasions and pinned pieces)
+	template <Color side, MoveGenType type>
+	void generatePawnMoves(Bitboard pawns, Bitboard targets, MoveList& moves) const noexcept;
+	template <Color side, PieceType type>
+	void generatePieceMoves(Bitboard movers, Bitboard targets, MoveList& moves) const noexcept;
+	template <Color side>
+	void generateCastlingMoves(MoveList& moves) const noexcept;
+	template <Color side, bool legalOnly>
+	void generateEnPassantMoves(MoveList& moves) const noexcept;
+
+	[[nodiscard]] bool isSquareAttacked(uint8_t square, Color attackingSide) const noexcept;
+
+	template <Color side>
+	[[nodiscard]] Bitboard computeAttackedSquares() const noexcept;
+
+	// These keep _squares and the bitboards in sync, and invalidate the attack map cache.
+	// rollbackMove() restores the hashes wholesale, so it skips updating them.
+	template <bool updateHash = true>
+	void putPiece(uint8_t square, Piece piece) noexcept;
+	template <bool updateHash = true>
+	void removePiece(uint8_t square) noexcept;
+	template <bool updateHash = true>
+	void movePiece(uint8_t from, uint8_t to) noexcept;
+
+	[[nodiscard]] inline uint8_t kingSquare(Color side) const noexcept { return side == White ? _wKingSquare : _bKingSquare; }
+
+	// Debug self-check: compares the incremental hashes against a full recompute
+	[[nodiscard]] bool hashIsValid() const noexcept;
 
 private:
 	// Row-wise. 0..7 is rank 1, 8..15 is rank 2 and so on
 	std::array<Piece, 64> _squares;
+	std::array<Bitboard, King + 1> _typeBB {}; // Indexed by PieceType, the EmptySquare entry is unused
+	std::array<Bitboard, 2> _colorBB {};
 	uint8_t _enPassantSquare = 0;
 	// TODO: using bitfield can save 1 byte
 	Color _sideToMove       = Color::White;
 	uint8_t _castlingRights = 0;
 	uint8_t _wKingSquare    = 0;
 	uint8_t _bKingSquare    = 0;
+
+	uint64_t _hash = 0;
+	uint64_t _pawnHash = 0;
+
+	mutable std::array<Bitboard, 2> _attackedSquares {}; // Indexed by the attacking side
+	mutable uint8_t _attackedSquaresValid = 0; // One bit per side
 };
@@ -4,28 +4,14 @@
 #include <algorithm>
 #include <assert.h>
 
-float eval(const Board& board) noexcept
+int eval(const Board& board) noexcept
 {
-	static constexpr auto evalPiece = [](PieceType type) noexcept {
-		switch (type)
-		{
-		case PieceType::Pawn: return 1.0f;
-		case PieceType::Knight: return 3.0f;
-		case PieceType::Bishop: return 3.1f;
-		case PieceType::Rook: return 5.0f;
-		case PieceType::Queen: return 9.0f;
-		default: return 0.0f;
-		}
-	};
-
-	float score = 0.0f;
-
-	for (uint8_t i = 0; i < 64; ++i)
+	// The bitboards serve as per-side piece lists, only the piece counts are needed here
+	int score = 0;
+	for (const PieceType type : { Pawn, Knight, Bishop, Rook, Queen })
 	{
-		const auto piece = board.pieceAt(i);
-		const float multiplier = piece.color() == Color::White ? 1.0f : -1.0f;
-
-		score += evalPiece(piece.type()) * multiplier;
+		const int count = popCount(board.pieces(type, White)) - popCount(board.pieces(type, Black));
+		score += pieceValue(type) * count;
 	}
 
 	return score;
@@ -34,11 +20,5 @@ float eval(const Board& board) noexcept
 bool isDrawPosition(const Board& board) noexcept
 {
 	// True if no pieces left other than kings
-	for (uint8_t i = 0; i < 64; ++i)
-	{
-		if (board.pieceAt(i).type() != PieceType::King)
-			return false;
-	}
-
-	return true;
+	return board.occupied() == board.pieces(King);
 }
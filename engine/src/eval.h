@@ -1,15 +1,25 @@
 #pragma once
+#include "piecetype.h"
+
 #include <stdint.h>
 
 class Board;
 class Move;
 
-enum EvalFlags : uint8_t {
-	None = 0,
-	Mate = 1,
-	Stalemate = 2,
-	Draw = 4
-};
+// Material value in centipawns
+[[nodiscard]] inline constexpr int pieceValue(PieceType type) noexcept
+{
+	switch (type)
+	{
+	case PieceType::Pawn: return 100;
+	case PieceType::Knight: return 300;
+	case PieceType::Bishop: return 310;
+	case PieceType::Rook: return 500;
+	case PieceType::Queen: return 900;
+	default: return 0;
+	}
+}
 
-[[nodiscard]] float eval(const Board& board) noexcept;
+// Static evaluation in centipawns, from White's point of view
+[[nodiscard]] int eval(const Board& board) noexcept;
 [[nodiscard]] bool isDrawPosition(const Board& board) noexcept;
@@ -5,23 +5,49 @@
 
 #include <assert.h>
 
+// Stored in the 4 high bits of Move. Bit 2 marks captures, bit 3 marks promotions.
+enum MoveKind : uint8_t {
+	QuietMove        = 0,
+	DoublePawnPush   = 1,
+	KingSideCastle   = 2,
+	QueenSideCastle  = 3,
+	CaptureMove      = 4,
+	EnPassantCapture = 5,
+	PromotionFlag    = 8  // The low 2 bits hold the promoted piece: Knight, Bishop, Rook or Queen
+};
+
+[[nodiscard]] inline constexpr MoveKind promotionKind(PieceType promotion, bool capture) noexcept
+{
+	assert(promotion >= Knight && promotion <= Queen);
+	return static_cast<MoveKind>(PromotionFlag | (capture ? CaptureMove : QuietMove) | (promotion - Knight));
+}
+
 class Move {
 public:
 	inline constexpr Move() noexcept = default;
 
-	inline constexpr Move(uint8_t from_, uint8_t to_, bool capture = false, PieceType promotion_ = EmptySquare) noexcept :
-		_from{from_}, _to{to_}, _promotion{promotion_}, _isCapture{capture}
+	inline constexpr Move(uint8_t from_, uint8_t to_, MoveKind kind_ = QuietMove) noexcept :
+		_from{from_}, _to{to_}, _kind{kind_}
 	{}
 
 	// Getters
 	[[nodiscard]] constexpr uint8_t from() const noexcept { return _from; }
 	[[nodiscard]] constexpr uint8_t to() const noexcept { return _to; }
-	[[nodiscard]] constexpr PieceType promotion() const noexcept { return static_cast<PieceType>(_promotion); }
+	[[nodiscard]] constexpr MoveKind kind() const noexcept { return static_cast<MoveKind>(_kind); }
 
-	[[nodiscard]] constexpr bool isCapture() const noexcept { return _isCapture; }
+	[[nodiscard]] constexpr bool isCapture() const noexcept { return (_kind & CaptureMove) != 0; }
+	[[nodiscard]] constexpr bool isPromotion() const noexcept { return (_kind & PromotionFlag) != 0; }
+	[[nodiscard]] constexpr bool isCastling() const noexcept { return _kind == KingSideCastle || _kind == QueenSideCastle; }
+	[[nodiscard]] constexpr bool isEnPassant() const noexcept { return _kind == EnPassantCapture; }
+
+	[[nodiscard]] constexpr PieceType promotion() const noexcept {
+		return isPromotion() ? static_cast<PieceType>(Knight + (_kind & 0b11)) : EmptySquare;
+	}
 
 	[[nodiscard]] constexpr bool isNull() const noexcept { return _from == 0 && _to == 0; }
 
+	[[nodiscard]] constexpr bool operator==(const Move& other) const noexcept = default;
+
 	[[nodiscard]] std::string notation() const noexcept {
 		static constexpr auto pieceTypeNotation = [](PieceType type) noexcept -> char {
 			switch (type)
@@ -37,7 +63,7 @@ public:
 		};
 
 		std::string str = indexToSquareNotation(_from) + indexToSquareNotation(_to);
-		if (_promotion != EmptySquare)
+		if (isPromotion())
 			str += pieceTypeNotation(promotion());
 
 		return str;
@@ -45,10 +71,10 @@ public:
 
 private:
 	// Has to be uint16_t to be packed into 2 bytes
-	uint16_t _from       : 6;
-	uint16_t _to         : 6;
-	uint16_t _promotion : 3;  // If it's a pawn promotion move, specify the promoted piece type
-	uint16_t _isCapture      : 1;
+	// A default constructed move is the null move
+	uint16_t _from : 6 = 0;
+	uint16_t _to   : 6 = 0;
+	uint16_t _kind : 4 = QuietMove; // MoveKind
 };
 
 static_assert(sizeof(Move) == 2);
@@ -19,6 +19,20 @@ inline constexpr int rookMoveVectors[4][2] {
 	{-1, 0}, {0, -1}, {1, 0}, {0, 1}
 };
 
+inline constexpr int kingMoveVectors[8][2] {
+	{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}
+};
+
+// For White; Black pawns attack in the opposite rank direction
 inline constexpr int pawnAttackVectors[2][2] {
 	{1, 1}, {1, -1}
-};
\ No newline at end of file
+};
+
+// Per-side pawn and castling geometry, indexed by Color
+inline constexpr int pawnPushVectors[2][2] {
+	{1, 0}, {-1, 0}
+};
+
+inline constexpr int pawnStartRank[2] { 1, 6 };
+inline constexpr int pawnPromotionRank[2] { 7, 0 };
+inline constexpr int backRank[2] { 0, 7 };
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "movepicker.h"
+#include "eval.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <utility>
+
+int staticExchange(const Board& board, const Move move) noexcept
+{
+	// The king can only take last, a recapture would win more than any exchange is worth
+	static constexpr auto exchangeValue = [](PieceType type) noexcept {
+		return type == King ? 20000 : pieceValue(type);
+	};
+
+	const uint8_t to = move.to();
+	Bitboard occupied = board.occupied() ^ squareBit(move.from());
+	// The pawn taken en passant is next to the capturing one, on the target file
+	if (move.isEnPassant())
+		occupied ^= squareBit(static_cast<uint8_t>(move.from() / 8 * 8 + to % 8));
+
+	// gain[i] is the balance for the side making the i-th capture if the exchange stops right after it
+	std::array<int, 32> gain;
+	gain[0] = move.isEnPassant() ? pieceValue(Pawn) : exchangeValue(board.pieceAt(to).type());
+	PieceType onTarget = board.pieceAt(move.from()).type();
+	if (move.isPromotion())
+	{
+		gain[0] += pieceValue(move.promotion()) - pieceValue(Pawn);
+		onTarget = move.promotion();
+	}
+
+	size_t depth = 0;
+	Color side = board.sideToMove();
+	// Recomputed after every capture, which brings in the sliders that were behind the capturing piece
+	Bitboard attackers = board.attackersTo(to, occupied) & occupied;
+	while (depth + 1 < gain.size())
+	{
+		side = oppositeSide(side);
+		const Bitboard ownAttackers = attackers & board.pieces(side);
+		if (ownAttackers == 0)
+			break;
+
+		PieceType capturer = Pawn;
+		while ((ownAttackers & board.pieces(capturer)) == 0)
+			capturer = static_cast<PieceType>(capturer + 1);
+
+		++depth;
+		gain[depth] = exchangeValue(onTarget) - gain[depth - 1];
+
+		occupied ^= squareBit(lsb(ownAttackers & board.pieces(capturer)));
+		attackers = board.attackersTo(to, occupied) & occupied;
+		onTarget = capturer;
+	}
+
+	// Each side either makes its capture or stops the exchange before it, whichever is better for it
+	for (; depth > 0; --depth)
+		gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+
+	return gain[0];
+}
+
+MovePicker::MovePicker(const Board& board, Move hashMove, Move killer1, Move killer2, Move counterMove, const ButterflyHistory* history) noexcept :
+	_board{ board },
+	_history{ history },
+	_hashMove{ hashMove },
+	_refutations{ killer1, killer2, counterMove }
+{
+	// A refutation is a quiet move that caused a cutoff elsewhere in the tree. Captures get here on their own merit.
+	// Their legality is only checked once their stage is reached, most nodes cut off before that.
+	for (auto it = _refutations.begin(); it != _refutations.end(); ++it)
+	{
+		const bool duplicate = std::find(_refutations.begin(), it, *it) != it;
+		if (duplicate || *it == _hashMove || it->isCapture() || it->isPromotion())
+			*it = {};
+	}
+}
+
+MovePicker MovePicker::noisyMovesOnly(const Board& board) noexcept
+{
+	MovePicker picker{ board };
+	picker._noisyOnly = true;
+	picker._stage = GenerateCapturesStage;
+	return picker;
+}
+
+Move MovePicker::next() noexcept
+{
+	switch (_stage)
+	{
+	case HashMoveStage:
+		_stage = GenerateCapturesStage;
+		// An illegal hash move is never generated either, so it doesn't have to be cleared for isAlreadyPicked()
+		if (_board.isLegal(_hashMove))
+			return _hashMove;
+		[[fallthrough]];
+
+	case GenerateCapturesStage:
+		_board.generateCaptures(_moves);
+		scoreCaptures();
+		_stage = GoodCapturesStage;
+		[[fallthrough]];
+
+	case GoodCapturesStage:
+		while (_current < _moves.count())
+		{
+			const Move move = pickBest();
+			++_current;
+			if (isAlreadyPicked(move))
+				continue;
+
+			// Only the captures of a cheaper piece can lose material, the exchange is only worth evaluating for them
+			const PieceType victim = move.isEnPassant() ? Pawn : _board.pieceAt(move.to()).type();
+			const bool mayLose = !move.isPromotion() && pieceValue(victim) < pieceValue(_board.pieceAt(move.from()).type());
+			if (mayLose && staticExchange(_board, move) < 0)
+				_badCaptures.emplace_back(move);
+			else
+				return move;
+		}
+
+		_current = 0;
+		if (_noisyOnly)
+		{
+			_stage = BadCapturesStage;
+			return next();
+		}
+
+		_stage = RefutationsStage;
+		[[fallthrough]];
+
+	case RefutationsStage:
+		while (_current < _refutations.size())
+		{
+			const Move refutation = _refutations[_current++];
+			if (_board.isLegal(refutation))
+				return refutation;
+		}
+
+		_stage = GenerateQuietsStage;
+		[[fallthrough]];
+
+	case GenerateQuietsStage:
+		_moves.clear();
+		_board.generateQuietMoves(_moves);
+		scoreQuiets();
+		_current = 0;
+		_stage = QuietsStage;
+		[[fallthrough]];
+
+	case QuietsStage:
+		while (_current < _moves.count())
+		{
+			const Move move = _history ? pickBest() : _moves[_current];
+			++_current;
+			if (!isAlreadyPicked(move))
+				return move;
+		}
+
+		_current = 0;
+		_stage = BadCapturesStage;
+		[[fallthrough]];
+
+	case BadCapturesStage:
+		// Already in the order they were picked in
+		if (_current < _badCaptures.count())
+			return _badCaptures[_current++];
+
+		_stage = Done;
+		[[fallthrough]];
+
+	case Done:
+		return {};
+	}
+
+	assert(false);
+	return {};
+}
+
+void MovePicker::scoreCaptures() noexcept
+{
+	for (uint8_t i = 0; i < _moves.count(); ++i)
+	{
+		const Move move = _moves[i];
+		int16_t score = 0;
+		if (move.isCapture())
+		{
+			// MVV-LVA: the victim type dominates, the cheaper attacker breaks the ties
+			const PieceType victim = move.isEnPassant() ? Pawn : _board.pieceAt(move.to()).type();
+			const PieceType attacker = _board.pieceAt(move.from()).type();
+			score = static_cast<int16_t>(victim * 8 - attacker);
+		}
+
+		if (move.isPromotion())
+			score += static_cast<int16_t>(move.promotion() * 8);
+
+		_scores[i] = score;
+	}
+}
+
+void MovePicker::scoreQuiets() noexcept
+{
+	if (!_history)
+		return;
+
+	const auto& history = (*_history)[_board.sideToMove()];
+	for (uint8_t i = 0; i < _moves.count(); ++i)
+		_scores[i] = history[_moves[i].from()][_moves[i].to()];
+}
+
+Move MovePicker::pickBest() noexcept
+{
+	// Selection sort, one step at a time: after a cutoff the rest of the list is never sorted
+	uint8_t best = _current;
+	for (uint8_t i = _current + 1; i < _moves.count(); ++i)
+	{
+		if (_scores[i] > _scores[best])
+			best = i;
+	}
+
+	std::swap(_moves[_current], _moves[best]);
+	std::swap(_scores[_current], _scores[best]);
+	return _moves[_current];
+}
+
+bool MovePicker::isAlreadyPicked(const Move move) const noexcept
+{
+	return move == _hashMove || std::find(_refutations.begin(), _refutations.end(), move) != _refutations.end();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "board.h"
+
+#include <array>
+
+// Butterfly history: a score for every quiet move, indexed by [side][from][to].
+// The search raises it for the moves that cause beta cutoffs and lowers it for the quiet moves searched before them in vain.
+using ButterflyHistory = std::array<std::array<std::array<int16_t, 64>, 64>, 2>;
+
+// Static exchange evaluation: the material won or lost by the capture once all the recaptures on the target square are played out,
+// each side always recapturing with its least valuable piece and only as long as that pays off. Pins are not taken into account.
+[[nodiscard]] int staticExchange(const Board& board, Move move) noexcept;
+
+// Hands out the legal moves of a position one at a time, generating them in stages:
+// the hash move, the captures and promotions that don't lose material (most valuable victim / least valuable attacker first),
+// the killer moves and the counter move, the quiet moves (best history first), and then the captures that lose material.
+// Most nodes of an alpha-beta search cut off after the first few moves, so the later stages are often never generated.
+class MovePicker
+{
+public:
+	// The hash move, the killers and the counter move may come from other positions, each is checked for legality when its stage is reached.
+	// Without a history, the quiet moves come in the order they are generated in.
+	MovePicker(const Board& board, Move hashMove = {}, Move killer1 = {}, Move killer2 = {}, Move counterMove = {}, const ButterflyHistory* history = nullptr) noexcept;
+	// Only the captures and promotions, for the quiescence search
+	[[nodiscard]] static MovePicker noisyMovesOnly(const Board& board) noexcept;
+
+	// Returns a null move once all the moves have been picked
+	[[nodiscard]] Move next() noexcept;
+
+private:
+	enum Stage : uint8_t {
+		HashMoveStage,
+		GenerateCapturesStage,
+		GoodCapturesStage,
+		RefutationsStage,
+		GenerateQuietsStage,
+		QuietsStage,
+		BadCapturesStage,
+		Done
+	};
+
+	void scoreCaptures() noexcept;
+	void scoreQuiets() noexcept;
+	// Moves the best scored remaining move to _current and returns it
+	[[nodiscard]] Move pickBest() noexcept;
+	// The hash move and the refutations are returned by their own stages
+	[[nodiscard]] bool isAlreadyPicked(Move move) const noexcept;
+
+private:
+	const Board& _board;
+	const ButterflyHistory* _history;
+	MoveList _moves;
+	std::array<int16_t, MoveList::capacity> _scores;
+	// Deferred by the good captures stage until after the quiet moves
+	MoveList _badCaptures;
+
+	Move _hashMove;
+	// The killers and the counter move: quiet moves that refuted other moves earlier in the search
+	std::array<Move, 3> _refutations;
+
+	uint8_t _current = 0;
+	Stage _stage = HashMoveStage;
+	bool _noisyOnly = false;
+};
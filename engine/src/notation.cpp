@@ -161,4 +161,12 @@ void parseFEN(std::istringstream& iss, Board& board)
 
 	[[maybe_unused]] const auto newFen = generateFEN(board);
 	assert(newFen == initialPosition + " " + activeColor + " " + castlingAvailability + " " + enPassantSquare + " " + "0" + ' ' + "1");
+}
+
+Board boardFromFEN(std::string_view fen)
+{
+	Board board;
+	std::istringstream iss{ std::string{ fen } };
+	parseFEN(iss, board);
+	return board;
 }
\ No newline at end of file
@@ -26,3 +26,5 @@ class Board;
 
 [[nodiscard]] std::string generateFEN(const Board& board);
 void parseFEN(std::istringstream& iss, Board& board);
+// A position given on its own, not as a part of a longer command
+[[nodiscard]] Board boardFromFEN(std::string_view fen);
@@ -1,65 +1,270 @@
 #include "perft.h"
 #include "board.h"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 
-inline constexpr uint8_t toSquare(uint8_t rank, uint8_t file) noexcept
+PerftHashTable::PerftHashTable(size_t sizeMb)
 {
-	return rank * 8 + file;
+	// A power of two number of entries, so that the index is just the low bits of the key
+	const size_t entries = std::bit_floor(std::max(sizeMb * 1024 * 1024 / sizeof(Entry), size_t{ 1 }));
+	_entries = std::vector<Entry>(entries);
+	_indexMask = entries - 1;
 }
 
-static void perft(Board& board, size_t depth, PerftResults& results, const PerftPrintFunc& printFunc, bool print) noexcept
+// The same position at a different depth is a different entry, and so is a node count without the detailed stats
+static uint64_t perftHashKey(uint64_t hash, size_t depth, bool detailed) noexcept
 {
+	return hash ^ ((depth * 2 + detailed) * 0x9E3779B97F4A7C15ULL);
+}
+
+bool PerftHashTable::probe(uint64_t hash, size_t depth, bool detailed, PerftResults& results) const noexcept
+{
+	const uint64_t key = perftHashKey(hash, depth, detailed);
+	const Entry& entry = _entries[key & _indexMask];
+
+	const PerftResults stored {
+		entry.nodes.load(std::memory_order_relaxed),
+		entry.enPassant.load(std::memory_order_relaxed),
+		entry.castling.load(std::memory_order_relaxed),
+		entry.captures.load(std::memory_order_relaxed)
+	};
+
+	if ((entry.check.load(std::memory_order_relaxed) ^ stored.nodes ^ stored.enPassant ^ stored.castling ^ stored.captures) != key)
+		return false;
+
+	results.nodes += stored.nodes;
+	results.enPassant += stored.enPassant;
+	results.castling += stored.castling;
+	results.captures += stored.captures;
+	return true;
+}
+
+void PerftHashTable::store(uint64_t hash, size_t depth, bool detailed, const PerftResults& results) noexcept
+{
+	const uint64_t key = perftHashKey(hash, depth, detailed);
+	Entry& entry = _entries[key & _indexMask];
+
+	// Always replacing: the deeper entries are not worth much more, they are revisited much less often
+	entry.check.store(key ^ results.nodes ^ results.enPassant ^ results.castling ^ results.captures, std::memory_order_relaxed);
+	entry.nodes.store(results.nodes, std::memory_order_relaxed);
+	entry.enPassant.store(results.enPassant, std::memory_order_relaxed);
+	entry.castling.store(results.castling, std::memory_order_relaxed);
+	entry.captures.store(results.captures, std::memory_order_relaxed);
+}
+
+// The side to move alternates with every ply, so it is a template parameter and no level has to dispatch on it at runtime.
+// Without 'detailed', only the nodes are counted.
+template <Color side, bool detailed>
+static void perft(Board& board, size_t depth, PerftResults& results, PerftHashTable* hashTable, const PerftPrintFunc& printFunc, bool print) noexcept
+{
+	// The last ply is counted in bulk, storing it would cost more than recomputing it
+	const bool useHash = hashTable && depth > 1 && !print;
+	if (useHash && hashTable->probe(board.hash(), depth, detailed, results))
+		return;
+
+	const PerftResults resultsBefore = results;
+
 	MoveList moves;
-	board.generateMoves(board.sideToMove(), moves);
-	for (Move move : moves)
-	{
-		const uint64_t prevNodesCount = results.nodes;
+	board.generateLegalMoves<side>(moves);
 
-		Board oldBoard = board;
-		if (board.applyMove(move))
+	if (depth == 1)
+	{
+		// The moves are legal, so the leaves can be counted without making them
+		results.nodes += moves.count();
+		if constexpr (detailed)
 		{
-			if (depth == 1)
+			for (Move move : moves)
 			{
-				results.nodes += 1;
-
-				// Detect castling moves
-				if (board.pieceAt(move.to()).type() == King &&
-					(
-						(move.from() == toSquare(0, 4) && move.to() == toSquare(0, 6)) ||
-						(move.from() == toSquare(7, 4) && move.to() == toSquare(7, 6)) ||
-						(move.from() == toSquare(0, 4) && move.to() == toSquare(0, 2)) ||
-						(move.from() == toSquare(7, 4) && move.to() == toSquare(7, 2))
-					)) [[unlikely]]
-				{
+				// The move kind tells castling and en passant apart, no need to look at the board
+				if (move.isCastling()) [[unlikely]]
 					results.castling += 1;
-				}
 				else
 				{
-					// Detect en passant moves
-					if (board.pieceAt(move.to()).type() == Pawn && move.isCapture() && oldBoard.pieceAt(move.to()).type() == EmptySquare) [[unlikely]]
+					if (move.isEnPassant()) [[unlikely]]
 						results.enPassant += 1;
 
 					results.captures += (uint64_t)move.isCapture();
 				}
 			}
-			else
-			{
-				perft(board, depth - 1, results, printFunc, false);
-			}
+		}
 
-			if (print && printFunc) [[unlikely]]
-			{
-				printFunc(move.notation(), results.nodes - prevNodesCount);
-				//std::cout << "Duplicates: " << duplicates << std::endl;
-			}
+		if (print && printFunc) [[unlikely]]
+		{
+			for (Move move : moves)
+				printFunc(move.notation(), 1);
+		}
+
+		return;
+	}
+
+	for (Move move : moves)
+	{
+		const uint64_t prevNodesCount = results.nodes;
+
+		const auto rollbackInfo = board.applyMove<side>(move);
+		perft<oppositeSide(side), detailed>(board, depth - 1, results, hashTable, printFunc, false);
+		board.rollbackMove<side>(move, rollbackInfo);
+
+		if (print && printFunc) [[unlikely]]
+		{
+			printFunc(move.notation(), results.nodes - prevNodesCount);
+			//std::cout << "Duplicates: " << duplicates << std::endl;
 		}
+	}
 
-		board = oldBoard;
+	if (useHash)
+	{
+		const PerftResults subtree {
+			results.nodes - resultsBefore.nodes,
+			results.enPassant - resultsBefore.enPassant,
+			results.castling - resultsBefore.castling,
+			results.captures - resultsBefore.captures
+		};
+		hashTable->store(board.hash(), depth, detailed, subtree);
 	}
 }
 
-void perft(Board& board, size_t depth, PerftResults& results, const PerftPrintFunc& printFunc) noexcept
+template <bool detailed>
+static void perft(Board& board, size_t depth, PerftResults& results, PerftHashTable* hashTable, const PerftPrintFunc& printFunc, bool print) noexcept
 {
-	perft(board, depth, results, printFunc, true);
+	if (board.sideToMove() == White)
+		perft<White, detailed>(board, depth, results, hashTable, printFunc, print);
+	else
+		perft<Black, detailed>(board, depth, results, hashTable, printFunc, print);
+}
+
+static void perftSubtree(Board& board, size_t depth, PerftResults& results, const PerftOptions& options) noexcept
+{
+	if (options.detailedStats)
+		perft<true>(board, depth, results, options.hashTable, {}, false);
+	else
+		perft<false>(board, depth, results, options.hashTable, {}, false);
+}
+
+static void operator+=(PerftResults& a, const PerftResults& b) noexcept
+{
+	a.nodes += b.nodes;
+	a.enPassant += b.enPassant;
+	a.castling += b.castling;
+	a.captures += b.captures;
+}
+
+// A subtree for one worker: the moves leading to it from the root (the first one being the root move) and its results
+struct PerftTask {
+	Move moves[2];
+	uint8_t movesCount = 0;
+	uint8_t rootMoveIndex = 0;
+	PerftResults results;
+};
+
+static void parallelPerft(Board& board, size_t depth, PerftResults& results, const PerftPrintFunc& printFunc, const PerftOptions& options) noexcept
+{
+	const size_t threadCount = options.threads;
+	MoveList rootMoves;
+	board.generateLegalMoves(rootMoves);
+
+	// There are only 20-50 root moves, too few to keep many threads equally busy; splitting one ply deeper gives ~1000 tasks
+	std::vector<PerftTask> tasks;
+	const bool splitDeeper = depth >= 3 && threadCount > 4;
+	for (uint8_t i = 0; i < rootMoves.count(); ++i)
+	{
+		if (!splitDeeper)
+		{
+			tasks.push_back({ { rootMoves[i] }, 1, i, {} });
+			continue;
+		}
+
+		const auto rollbackInfo = board.applyMove(rootMoves[i]);
+		MoveList replies;
+		board.generateLegalMoves(replies);
+		for (Move reply : replies)
+			tasks.push_back({ { rootMoves[i], reply }, 2, i, {} });
+		board.rollbackMove(rootMoves[i], rollbackInfo);
+	}
+
+	std::atomic<size_t> nextTask = 0;
+	const auto worker = [&, board]() mutable noexcept {
+		for (size_t taskIndex = nextTask++; taskIndex < tasks.size(); taskIndex = nextTask++)
+		{
+			PerftTask& task = tasks[taskIndex];
+			Board::RollbackInfo rollbackInfo[2];
+			for (uint8_t i = 0; i < task.movesCount; ++i)
+				rollbackInfo[i] = board.applyMove(task.moves[i]);
+
+			perftSubtree(board, depth - task.movesCount, task.results, options);
+
+			for (uint8_t i = task.movesCount; i-- > 0; )
+				board.rollbackMove(task.moves[i], rollbackInfo[i]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < threadCount; ++i)
+		threads.emplace_back(worker);
+	for (auto& thread : threads)
+		thread.join();
+
+	// A root move that mates gets no tasks in the deeper split, which is right: it has no nodes at depth 3 and beyond
+	std::vector<PerftResults> rootMoveResults(rootMoves.count());
+	for (const PerftTask& task : tasks)
+		rootMoveResults[task.rootMoveIndex] += task.results;
+
+	for (uint8_t i = 0; i < rootMoves.count(); ++i)
+	{
+		results += rootMoveResults[i];
+		if (printFunc)
+			printFunc(rootMoves[i].notation(), rootMoveResults[i].nodes);
+	}
+}
+
+void perft(Board& board, size_t depth, PerftResults& results, const PerftPrintFunc& printFunc, const PerftOptions& options) noexcept
+{
+	if (options.threads > 1 && depth > 1)
+		parallelPerft(board, depth, results, printFunc, options);
+	else if (options.detailedStats)
+		perft<true>(board, depth, results, options.hashTable, printFunc, true);
+	else
+		perft<false>(board, depth, results, options.hashTable, printFunc, true);
+}
+
+std::vector<PerftSuitePosition> loadPerftSuite(std::string_view path)
+{
+	std::vector<PerftSuitePosition> positions;
+	std::ifstream file{ std::string{ path } };
+	if (!file.is_open())
+		return positions;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line.front() == '#')
+			continue;
+
+		std::istringstream ss{ line };
+		std::string token;
+		while (std::getline(ss, token, ';'))
+		{
+			std::istringstream localstream{ token };
+			if (token.starts_with('D'))
+			{
+				std::string depthString, nodeCountString;
+				localstream >> std::skipws >> depthString >> nodeCountString;
+
+				PerftSuitePosition::Depth depth;
+				std::from_chars(depthString.data() + 1, depthString.data() + depthString.size(), depth.depth);
+				std::from_chars(nodeCountString.data(), nodeCountString.data() + nodeCountString.size(), depth.nodes);
+				positions.back().expectedNodes.push_back(depth);
+			}
+			else // FEN
+				positions.push_back({ token, {} });
+		}
+	}
+
+	return positions;
 }
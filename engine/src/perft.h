@@ -1,12 +1,16 @@
 #pragma once
 #include <stdint.h>
+#include <atomic>
 #include <functional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 class Board;
 
 struct PerftResults {
 	uint64_t nodes = 0;
+	// Only counted with PerftOptions::detailedStats
 	uint64_t enPassant = 0;
 	uint64_t castling = 0;
 	uint64_t captures = 0;
@@ -14,4 +18,50 @@ struct PerftResults {
 
 using PerftPrintFunc = std::function<void (std::string_view move, uint64_t nodes)>;
 
-void perft(Board& board, size_t depth, PerftResults& results, const PerftPrintFunc& printFunc = {}) noexcept;
+// Remembers the results of the subtrees (position + remaining depth), so that a subtree reached again by transposition is counted only once.
+// Shared between the threads without locking: an entry torn by two threads writing it at once fails the XOR check and is simply a miss.
+class PerftHashTable
+{
+public:
+	explicit PerftHashTable(size_t sizeMb);
+
+	[[nodiscard]] bool probe(uint64_t hash, size_t depth, bool detailed, PerftResults& results) const noexcept;
+	void store(uint64_t hash, size_t depth, bool detailed, const PerftResults& results) noexcept;
+
+private:
+	struct Entry {
+		std::atomic<uint64_t> check; // The key XOR all the counters
+		std::atomic<uint64_t> nodes;
+		std::atomic<uint64_t> enPassant;
+		std::atomic<uint64_t> castling;
+		std::atomic<uint64_t> captures;
+	};
+
+	std::vector<Entry> _entries;
+	uint64_t _indexMask = 0;
+};
+
+struct PerftOptions {
+	// With more than one thread, the subtrees below the first ply or two are shared between that many worker threads,
+	// each working on its own copy of the board. The results (and the printFunc output order) don't depend on the thread count.
+	size_t threads = 1;
+	PerftHashTable* hashTable = nullptr; // Optional, may be reused between calls
+	// Also count the captures, castles and en passant captures. Without it the last ply is a bare move count.
+	bool detailedStats = false;
+};
+
+void perft(Board& board, size_t depth, PerftResults& results, const PerftPrintFunc& printFunc = {}, const PerftOptions& options = {}) noexcept;
+
+// A position from an EPD perft suite, one per line: "<FEN> ;D1 20 ;D2 400 ..."
+struct PerftSuitePosition {
+	struct Depth {
+		size_t depth = 0;
+		uint64_t nodes = 0;
+	};
+
+	std::string fen;
+	std::vector<Depth> expectedNodes;
+};
+
+// Returns an empty list if the file can't be read
+[[nodiscard]] std::vector<PerftSuitePosition> loadPerftSuite(std::string_view path);
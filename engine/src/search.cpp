@@ -0,0 +1,300 @@
+#include "search.h"
+#include "eval.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+Search::Search(const Board& board, const SearchLimits& limits, TranspositionTable* tt, const std::atomic<bool>* stopRequested, size_t threadIndex) noexcept :
+	_board{ board },
+	_limits{ limits },
+	_timeManager{ limits, board.sideToMove() },
+	_tt{ tt },
+	_stopRequested{ stopRequested },
+	_threadIndex{ threadIndex }
+{
+}
+
+// Mate scores are stored relative to the position rather than to the root, the same mate can be reached at a different ply
+[[nodiscard]] static int scoreToTT(int score, int ply) noexcept
+{
+	if (isMateScore(score))
+		return score > 0 ? score + ply : score - ply;
+	return score;
+}
+
+[[nodiscard]] static int scoreFromTT(int score, int ply) noexcept
+{
+	if (isMateScore(score))
+		return score > 0 ? score - ply : score + ply;
+	return score;
+}
+
+SearchResult Search::run(const SearchInfoCallback& onInfo) noexcept
+{
+	SearchResult result;
+	const size_t maxDepth = _limits.depth > 0 ? std::min(_limits.depth, size_t{ MaxPly - 1 }) : size_t{ MaxPly - 1 };
+
+	for (_rootDepth = 1; _rootDepth <= maxDepth; ++_rootDepth)
+	{
+		if (skipsDepth(_rootDepth))
+			continue;
+
+		const int score = negamax(static_cast<int>(_rootDepth), 0, -ScoreInfinity, ScoreInfinity);
+		if (_aborted)
+			break;
+
+		result = { _pvLength[0] > 0 ? _pv[0][0] : Move{}, score, nodes(), _rootDepth, _stats };
+		_previousBestMove = result.bestMove;
+
+		if (onInfo)
+			onInfo({ _rootDepth, score, nodes(), _timeManager.elapsedMs(), _tt ? _tt->hashfull() : 0, std::vector<Move>(_pv[0].begin(), _pv[0].begin() + _pvLength[0]) });
+
+		if (result.bestMove.isNull() || (_threadIndex == 0 && !_timeManager.canStartIteration()) || (_stopRequested && *_stopRequested))
+			break;
+	}
+
+	result.nodes = nodes();
+	result.stats = _stats;
+	return result;
+}
+
+bool Search::skipsDepth(size_t depth) const noexcept
+{
+	if (_threadIndex == 0)
+		return false;
+
+	// Each helper searches blocks of 'size' consecutive depths and skips the next block of the same size, starting at its own 'phase'.
+	// Between them, the helpers cover every depth in a few different ways.
+	static constexpr size_t skipSize[20] { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+	static constexpr size_t skipPhase[20] { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+	const size_t i = (_threadIndex - 1) % std::size(skipSize);
+	return ((depth + skipPhase[i]) / skipSize[i]) % 2 != 0;
+}
+
+// A capture that can't bring the score within this much of alpha is not searched in the quiescence search
+static constexpr int deltaMargin = 200;
+
+// The history scores stay within this, so that they fit into MovePicker's int16_t scores
+static constexpr int MaxHistory = 16384;
+
+void Search::countNode(int ply) noexcept
+{
+	_nodes.store(_nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	_pvLength[ply] = ply;
+}
+
+// The closer a history score is to the limit, the less it moves, so the recent cutoffs weigh more than the old ones
+static void updateHistory(int16_t& score, int bonus) noexcept
+{
+	score = static_cast<int16_t>(score + bonus - score * std::abs(bonus) / MaxHistory);
+}
+
+void Search::updateMoveOrdering(const Move move, const int depth, const int ply, const MoveList& failedQuiets) noexcept
+{
+	// The captures are ordered by the material alone
+	if (move.isCapture() || move.isPromotion())
+		return;
+
+	auto& killers = _killers[ply];
+	if (killers[0] != move)
+	{
+		killers[1] = killers[0];
+		killers[0] = move;
+	}
+
+	if (ply > 0)
+	{
+		const Move previousMove = _movesMade[ply - 1];
+		_counterMoves[_board.pieceAt(previousMove.to()).id()][previousMove.to()] = move;
+	}
+
+	// The deeper the subtree the cutoff saved, the more it counts
+	const int bonus = std::min(depth * depth, MaxHistory);
+	auto& history = _history[_board.sideToMove()];
+	updateHistory(history[move.from()][move.to()], bonus);
+	for (const Move failed : failedQuiets)
+		updateHistory(history[failed.from()][failed.to()], -bonus);
+}
+
+int Search::negamax(int depth, int ply, int alpha, int beta) noexcept
+{
+	if (depth <= 0)
+		return quiescence(ply, alpha, beta);
+
+	countNode(ply);
+
+	if (shouldAbort()) [[unlikely]]
+		return 0;
+
+	if (ply > 0 && isDrawPosition(_board)) [[unlikely]]
+		return 0;
+
+	if (ply >= MaxPly - 1) [[unlikely]]
+		return evaluate();
+
+	TTEntry ttEntry;
+	const bool ttHit = _tt && _tt->probe(_board.hash(), ttEntry);
+	// Not at the root, which has to come up with a move
+	if (ttHit && ply > 0 && ttEntry.depth >= depth)
+	{
+		const int ttScore = scoreFromTT(ttEntry.score, ply);
+		if (ttEntry.bound == ExactBound || (ttEntry.bound == LowerBound && ttScore >= beta) || (ttEntry.bound == UpperBound && ttScore <= alpha))
+			return ttScore;
+	}
+
+	const int originalAlpha = alpha;
+	int bestScore = -ScoreInfinity;
+	Move bestMove;
+
+	// The best move of the previous iteration is searched first, it is most likely still the best one. Elsewhere the hash move is.
+	const Move hashMove = ply == 0 && !_previousBestMove.isNull() ? _previousBestMove : ttEntry.move;
+	Move counterMove;
+	if (ply > 0)
+	{
+		const Move previousMove = _movesMade[ply - 1];
+		counterMove = _counterMoves[_board.pieceAt(previousMove.to()).id()][previousMove.to()];
+	}
+
+	MovePicker picker{ _board, hashMove, _killers[ply][0], _killers[ply][1], counterMove, &_history };
+	MoveList failedQuiets;
+	size_t movesSearched = 0;
+	for (Move move = picker.next(); !move.isNull(); move = picker.next())
+	{
+		_movesMade[ply] = move;
+		const auto rollbackInfo = _board.applyMove(move);
+		const int score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+		_board.rollbackMove(move, rollbackInfo);
+		++movesSearched;
+
+		if (_aborted) [[unlikely]]
+			return 0;
+
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestMove = move;
+		}
+
+		if (score > alpha)
+		{
+			alpha = score;
+
+			_pv[ply][ply] = move;
+			std::copy(_pv[ply + 1].begin() + ply + 1, _pv[ply + 1].begin() + _pvLength[ply + 1], _pv[ply].begin() + ply + 1);
+			_pvLength[ply] = _pvLength[ply + 1];
+
+			if (alpha >= beta) // The opponent won't allow this position, the remaining moves don't matter
+			{
+				++_stats.betaCutoffs;
+				if (movesSearched == 1)
+					++_stats.firstMoveCutoffs;
+				updateMoveOrdering(move, depth, ply, failedQuiets);
+				break;
+			}
+		}
+
+		if (!move.isCapture() && !move.isPromotion())
+			failedQuiets.emplace_back(move);
+	}
+
+	if (bestScore == -ScoreInfinity) [[unlikely]] // No legal moves
+		return _board.isInCheck(_board.sideToMove()) ? -ScoreMate + ply : 0;
+
+	if (_tt)
+	{
+		const Bound bound = bestScore >= beta ? LowerBound : (bestScore > originalAlpha ? ExactBound : UpperBound);
+		// After failing low, all the moves were refuted and none of them is known to be better than the others
+		_tt->store(_board.hash(), { bound == UpperBound ? Move{} : bestMove, static_cast<int16_t>(scoreToTT(bestScore, ply)), static_cast<uint8_t>(depth), bound });
+	}
+
+	return bestScore;
+}
+
+int Search::quiescence(int ply, int alpha, int beta) noexcept
+{
+	countNode(ply);
+
+	if (shouldAbort()) [[unlikely]]
+		return 0;
+
+	if (isDrawPosition(_board)) [[unlikely]]
+		return 0;
+
+	const bool inCheck = _board.isInCheck(_board.sideToMove());
+	if (ply >= MaxPly - 1) [[unlikely]]
+		return inCheck ? 0 : evaluate();
+
+	int bestScore = -ScoreInfinity;
+	if (!inCheck)
+	{
+		// Stand pat: the side to move doesn't have to capture, it can settle for the static evaluation
+		bestScore = evaluate();
+		if (bestScore >= beta)
+			return bestScore;
+
+		alpha = std::max(alpha, bestScore);
+	}
+
+	// In check, every evasion has to be tried: there is no standing pat
+	MovePicker picker = inCheck ? MovePicker{ _board } : MovePicker::noisyMovesOnly(_board);
+	for (Move move = picker.next(); !move.isNull(); move = picker.next())
+	{
+		// Delta pruning: even with a margin for the positional gain, the material won can't raise the score to alpha
+		if (!inCheck && !move.isPromotion())
+		{
+			const PieceType victim = move.isEnPassant() ? Pawn : _board.pieceAt(move.to()).type();
+			if (bestScore + pieceValue(victim) + deltaMargin <= alpha)
+				continue;
+		}
+
+		const auto rollbackInfo = _board.applyMove(move);
+		const int score = -quiescence(ply + 1, -beta, -alpha);
+		_board.rollbackMove(move, rollbackInfo);
+
+		if (_aborted) [[unlikely]]
+			return 0;
+
+		if (score <= bestScore)
+			continue;
+
+		bestScore = score;
+		if (score > alpha)
+		{
+			alpha = score;
+			if (alpha >= beta)
+				break;
+		}
+	}
+
+	if (bestScore == -ScoreInfinity) [[unlikely]] // Checkmated
+		return -ScoreMate + ply;
+
+	return bestScore;
+}
+
+int Search::evaluate() const noexcept
+{
+	const int score = eval(_board);
+	return _board.sideToMove() == White ? score : -score;
+}
+
+bool Search::shouldAbort() noexcept
+{
+	if (_aborted)
+		return true;
+
+	// The first iteration always completes, so that there is a move to play
+	if (_rootDepth <= 1)
+		return false;
+
+	const uint64_t nodeCount = nodes();
+	if (_limits.nodes > 0 && nodeCount >= _limits.nodes)
+		_aborted = true;
+	// Reading the clock is too slow to do on every node
+	else if ((nodeCount & 1023) == 0)
+		_aborted = (_stopRequested && _stopRequested->load(std::memory_order_relaxed)) || _timeManager.hardLimitReached();
+
+	return _aborted;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "board.h"
+#include "movepicker.h"
+#include "timemanager.h"
+#include "transpositiontable.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+// Scores are in centipawns, from the point of view of the side to move
+inline constexpr int ScoreInfinity = 32000;
+// Being mated in N plies scores -(ScoreMate - N), so that the quicker mates are preferred
+inline constexpr int ScoreMate = 31000;
+inline constexpr int MaxPly = 128;
+
+[[nodiscard]] inline constexpr bool isMateScore(int score) noexcept
+{
+	return score >= ScoreMate - MaxPly || score <= -(ScoreMate - MaxPly);
+}
+
+// Reported after every completed iteration
+struct SearchInfo {
+	size_t depth = 0;
+	int score = 0;
+	uint64_t nodes = 0;
+	int64_t timeMs = 0;
+	int hashfull = 0; // Permille
+	std::vector<Move> pv;
+};
+
+using SearchInfoCallback = std::function<void(const SearchInfo&)>;
+
+// Tells how good the move ordering is: when it is good, most of the beta cutoffs come from the first move searched
+struct SearchStats {
+	uint64_t betaCutoffs = 0;
+	uint64_t firstMoveCutoffs = 0;
+
+	[[nodiscard]] double firstMoveCutoffRate() const noexcept {
+		return betaCutoffs > 0 ? (double)firstMoveCutoffs / (double)betaCutoffs : 0.0;
+	}
+
+	SearchStats& operator+=(const SearchStats& other) noexcept {
+		betaCutoffs += other.betaCutoffs;
+		firstMoveCutoffs += other.firstMoveCutoffs;
+		return *this;
+	}
+};
+
+struct SearchResult {
+	Move bestMove; // Null if there are no legal moves
+	int score = 0;
+	uint64_t nodes = 0;
+	size_t depth = 0;
+	SearchStats stats; // The quiescence search is not counted
+};
+
+// Iterative deepening over a depth-first alpha-beta (negamax) search.
+// No tree is kept: the moves are made and unmade on a single board.
+// Several searches of the same position can run in parallel, sharing the transposition table (Lazy SMP). Thread 0 is the main one;
+// the helpers skip some of the depths, so that they are not all searching the same tree at once, and they don't stop on their own time limits.
+class Search
+{
+public:
+	// The time limits count from the construction. Setting 'stopRequested' aborts the search.
+	Search(const Board& board, const SearchLimits& limits, TranspositionTable* tt = nullptr, const std::atomic<bool>* stopRequested = nullptr, size_t threadIndex = 0) noexcept;
+
+	// Returns the result of the deepest completed iteration
+	[[nodiscard]] SearchResult run(const SearchInfoCallback& onInfo = {}) noexcept;
+
+	// Can be read from another thread while the search runs
+	[[nodiscard]] uint64_t nodes() const noexcept { return _nodes.load(std::memory_order_relaxed); }
+
+private:
+	[[nodiscard]] int negamax(int depth, int ply, int alpha, int beta) noexcept;
+	// Searches only the captures and promotions (all the moves when in check) until the position is quiet,
+	// so that the static evaluation is never taken in the middle of an exchange
+	[[nodiscard]] int quiescence(int ply, int alpha, int beta) noexcept;
+	void countNode(int ply) noexcept;
+	// A beta cutoff at 'ply' by 'move', after the quiet moves 'failedQuiets' were searched in vain
+	void updateMoveOrdering(Move move, int depth, int ply, const MoveList& failedQuiets) noexcept;
+	// eval() from the side to move's point of view
+	[[nodiscard]] int evaluate() const noexcept;
+
+	// Checks the limits; once it returns true, the current iteration is abandoned
+	[[nodiscard]] bool shouldAbort() noexcept;
+	// Whether this helper thread leaves the depth to the others
+	[[nodiscard]] bool skipsDepth(size_t depth) const noexcept;
+
+private:
+	Board _board;
+	const SearchLimits _limits;
+	const TimeManager _timeManager;
+	TranspositionTable* _tt;
+	const std::atomic<bool>* _stopRequested;
+	const size_t _threadIndex;
+
+	// Triangular principal variation table: _pv[ply] holds the best line found from 'ply' on, up to _pvLength[ply]
+	std::array<std::array<Move, MaxPly>, MaxPly> _pv;
+	std::array<int, MaxPly> _pvLength {};
+
+	// Move ordering heuristics, learned over all the iterations. Every thread has its own.
+	std::array<std::array<Move, 2>, MaxPly> _killers;
+	// The last quiet move to refute each move, indexed by the [piece id][target square] of the move refuted
+	std::array<std::array<Move, 64>, 16> _counterMoves;
+	ButterflyHistory _history {};
+	// The move being searched at each ply, the counter moves are looked up by the move that led to the position
+	std::array<Move, MaxPly> _movesMade;
+	SearchStats _stats;
+
+	Move _previousBestMove;
+	// Only written by the thread running the search
+	std::atomic<uint64_t> _nodes = 0;
+	size_t _rootDepth = 0;
+	bool _aborted = false;
+};
@@ -0,0 +1,53 @@
+#include "timemanager.h"
+
+#include <algorithm>
+
+// Time lost between the engine deciding on a move and the GUI stopping its clock
+static constexpr int64_t moveOverheadMs = 20;
+// How many more moves the remaining time has to last when the time control doesn't say
+static constexpr int64_t defaultMovesToGo = 30;
+
+TimeManager::TimeManager(const SearchLimits& limits, Color sideToMove) noexcept :
+	_start{ Clock::now() }
+{
+	if (limits.infinite)
+		return;
+
+	if (limits.moveTime > 0)
+	{
+		_timeLimited = true;
+		_hardLimitMs = _softLimitMs = std::max(limits.moveTime - moveOverheadMs, int64_t{ 1 });
+		return;
+	}
+
+	const int64_t time = limits.time[sideToMove];
+	if (time <= 0)
+		return;
+
+	_timeLimited = true;
+	const int64_t available = std::max(time - moveOverheadMs, int64_t{ 1 });
+	const int64_t movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, defaultMovesToGo) : defaultMovesToGo;
+
+	// The last move before the time control may use everything, otherwise some of the clock is held back for the moves to come
+	const int64_t maximum = movesToGo == 1 ? available : available * 3 / 4;
+	const int64_t target = available / movesToGo + limits.increment[sideToMove] * 3 / 4;
+
+	_hardLimitMs = std::clamp(target * 3, int64_t{ 1 }, maximum);
+	_softLimitMs = std::clamp(target, int64_t{ 1 }, _hardLimitMs);
+}
+
+int64_t TimeManager::elapsedMs() const noexcept
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _start).count();
+}
+
+bool TimeManager::canStartIteration() const noexcept
+{
+	// An iteration typically takes a few times longer than all the previous ones together
+	return !_timeLimited || elapsedMs() * 2 < _softLimitMs;
+}
+
+bool TimeManager::hardLimitReached() const noexcept
+{
+	return _timeLimited && elapsedMs() >= _hardLimitMs;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "piecetype.h"
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+// The limits of a search, as given by the UCI "go" command. Zero means "not set" for all of them.
+struct SearchLimits {
+	size_t depth = 0;
+	uint64_t nodes = 0;
+	int64_t time[2] {};      // Remaining clock time in ms, indexed by Color
+	int64_t increment[2] {}; // ms, indexed by Color
+	int64_t movesToGo = 0;
+	int64_t moveTime = 0;    // ms
+	bool infinite = false;
+};
+
+// Decides how long to think on a move. The clock starts when the TimeManager is created.
+// The soft limit is checked between iterations: a new iteration is not worth starting if it most likely won't finish.
+// The hard limit is checked during the search and aborts it, so that the engine always answers in time.
+class TimeManager
+{
+public:
+	TimeManager(const SearchLimits& limits, Color sideToMove) noexcept;
+
+	[[nodiscard]] int64_t elapsedMs() const noexcept;
+
+	// False once the next iteration is not likely to finish before the soft limit
+	[[nodiscard]] bool canStartIteration() const noexcept;
+	[[nodiscard]] bool hardLimitReached() const noexcept;
+
+	// In ms, both 0 when the search is not limited by time
+	[[nodiscard]] int64_t softLimitMs() const noexcept { return _softLimitMs; }
+	[[nodiscard]] int64_t hardLimitMs() const noexcept { return _hardLimitMs; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point _start;
+	int64_t _softLimitMs = 0;
+	int64_t _hardLimitMs = 0;
+	bool _timeLimited = false;
+};
@@ -0,0 +1,132 @@
+#include "transpositiontable.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+// The generation takes 6 bits of the data word and wraps around
+static constexpr uint8_t generationMask = 0x3F;
+
+TranspositionTable::TranspositionTable(size_t sizeMb)
+{
+	resize(sizeMb);
+}
+
+void TranspositionTable::resize(size_t sizeMb)
+{
+	// A power of two number of buckets, so that the index is just the low bits of the hash
+	const size_t buckets = std::bit_floor(std::max(sizeMb * 1024 * 1024 / sizeof(Bucket), size_t{ 1 }));
+	_buckets = std::vector<Bucket>(buckets);
+	_indexMask = buckets - 1;
+	_generation = 1;
+}
+
+void TranspositionTable::clear() noexcept
+{
+	for (Bucket& b : _buckets)
+	{
+		for (Slot& slot : b.slots)
+		{
+			slot.check.store(0, std::memory_order_relaxed);
+			slot.data.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	_generation = 1;
+}
+
+void TranspositionTable::newSearch() noexcept
+{
+	_generation = static_cast<uint8_t>(std::max((_generation + 1) & generationMask, 1));
+}
+
+// Bits 0-15: move, 16-31: score, 32-39: depth, 40-41: bound, 42-47: generation
+uint64_t TranspositionTable::pack(const TTEntry& entry, uint8_t generation) noexcept
+{
+	return uint64_t{ std::bit_cast<uint16_t>(entry.move) }
+		| uint64_t{ static_cast<uint16_t>(entry.score) } << 16
+		| uint64_t{ entry.depth } << 32
+		| uint64_t{ entry.bound } << 40
+		| uint64_t{ generation } << 42;
+}
+
+TTEntry TranspositionTable::unpack(uint64_t data) noexcept
+{
+	return {
+		std::bit_cast<Move>(static_cast<uint16_t>(data)),
+		static_cast<int16_t>(data >> 16),
+		static_cast<uint8_t>(data >> 32),
+		static_cast<Bound>((data >> 40) & ExactBound)
+	};
+}
+
+uint8_t TranspositionTable::generationOf(uint64_t data) noexcept
+{
+	return static_cast<uint8_t>(data >> 42) & generationMask;
+}
+
+bool TranspositionTable::probe(uint64_t hash, TTEntry& entry) const noexcept
+{
+	for (const Slot& slot : bucket(hash).slots)
+	{
+		const uint64_t data = slot.data.load(std::memory_order_relaxed);
+		if ((slot.check.load(std::memory_order_relaxed) ^ data) == hash && data != 0)
+		{
+			entry = unpack(data);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TranspositionTable::store(uint64_t hash, const TTEntry& entry) noexcept
+{
+	Bucket& b = bucket(hash);
+	TTEntry newEntry = entry;
+
+	// The slot of the same position if there is one, otherwise the least valuable one: shallow and from an old search
+	Slot* target = &b.slots[0];
+	int lowestValue = std::numeric_limits<int>::max();
+	for (Slot& slot : b.slots)
+	{
+		const uint64_t data = slot.data.load(std::memory_order_relaxed);
+		if ((slot.check.load(std::memory_order_relaxed) ^ data) == hash && data != 0)
+		{
+			// The newer result for the same position replaces the older one, but a move is better than no move
+			if (newEntry.move.isNull())
+				newEntry.move = unpack(data).move;
+
+			target = &slot;
+			break;
+		}
+
+		const int age = (_generation - generationOf(data)) & generationMask;
+		const int value = data == 0 ? std::numeric_limits<int>::min() : static_cast<int>(unpack(data).depth) - 8 * age;
+		if (value < lowestValue)
+		{
+			lowestValue = value;
+			target = &slot;
+		}
+	}
+
+	const uint64_t data = pack(newEntry, _generation);
+	target->check.store(hash ^ data, std::memory_order_relaxed);
+	target->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const noexcept
+{
+	const size_t sampleBuckets = std::min(_buckets.size(), size_t{ 250 });
+	int used = 0;
+	for (size_t i = 0; i < sampleBuckets; ++i)
+	{
+		for (const Slot& slot : _buckets[i].slots)
+		{
+			const uint64_t data = slot.data.load(std::memory_order_relaxed);
+			used += data != 0 && generationOf(data) == _generation;
+		}
+	}
+
+	return static_cast<int>(used * 1000 / (sampleBuckets * slotsPerBucket));
+}
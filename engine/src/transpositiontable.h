@@ -0,0 +1,71 @@
+#pragma once
+
+#include "move.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+enum Bound : uint8_t {
+	NoBound = 0,
+	UpperBound = 1, // The search failed low, the score is at most this
+	LowerBound = 2, // The search failed high, the score is at least this
+	ExactBound = UpperBound | LowerBound
+};
+
+struct TTEntry {
+	Move move;
+	int16_t score = 0;
+	uint8_t depth = 0;
+	Bound bound = NoBound;
+};
+
+// Remembers the search results by position, so that the work is reused when the position is reached again by transposition,
+// in the next iteration or in the next search. Shared between the search threads without locking, same as the PerftHashTable:
+// an entry torn by two threads writing it at once fails the XOR check and is simply a miss.
+class TranspositionTable
+{
+public:
+	explicit TranspositionTable(size_t sizeMb);
+
+	// Discards the contents
+	void resize(size_t sizeMb);
+	void clear() noexcept;
+	// To be called before each search, the entries from the earlier searches are replaced first
+	void newSearch() noexcept;
+
+	[[nodiscard]] bool probe(uint64_t hash, TTEntry& entry) const noexcept;
+	void store(uint64_t hash, const TTEntry& entry) noexcept;
+
+	// Permille of the table filled by the current search, estimated from a sample
+	[[nodiscard]] int hashfull() const noexcept;
+
+private:
+	// 16 bytes: the data and the position hash XOR the data
+	struct Slot {
+		std::atomic<uint64_t> check;
+		std::atomic<uint64_t> data; // Move, score, depth, bound and generation, see pack()
+	};
+
+	static constexpr size_t slotsPerBucket = 4;
+
+	// One cache line, so that a probe costs one memory access
+	struct alignas(64) Bucket {
+		Slot slots[slotsPerBucket];
+	};
+
+	static_assert(sizeof(Bucket) == 64);
+
+	[[nodiscard]] static uint64_t pack(const TTEntry& entry, uint8_t generation) noexcept;
+	[[nodiscard]] static TTEntry unpack(uint64_t data) noexcept;
+	[[nodiscard]] static uint8_t generationOf(uint64_t data) noexcept;
+
+	[[nodiscard]] Bucket& bucket(uint64_t hash) noexcept { return _buckets[hash & _indexMask]; }
+	[[nodiscard]] const Bucket& bucket(uint64_t hash) const noexcept { return _buckets[hash & _indexMask]; }
+
+private:
+	std::vector<Bucket> _buckets;
+	uint64_t _indexMask = 0;
+	uint8_t _generation = 1; // Never 0, so that an empty slot doesn't look like it's from the current search
+};
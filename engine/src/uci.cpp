@@ -10,13 +10,22 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
+#include <ctype.h>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string_view>
+#include <utility>
+
+// The search thread replies too
+static std::mutex replyMutex;
 
 template <typename... Ts>
 inline void reply(Ts &&...args)
 {
+	std::lock_guard lock{ replyMutex };
 	log("response: ", args...);
 	(std::cout << ... << args) << std::endl;
 }
@@ -43,13 +52,38 @@ void UciServer::run()
 	uci_loop();
 }
 
+static constexpr size_t maxHashSizeMb = 65536;
+static constexpr size_t maxThreadCount = 1024;
+
 static void uci_send_id()
 {
 	reply("id name GiraffeChess");
 	reply("id author Violet Giraffe");
+	reply("option name Hash type spin default ", Analyzer::defaultHashSizeMb, " min 1 max ", maxHashSizeMb);
+	reply("option name Threads type spin default 1 min 1 max ", maxThreadCount);
 	reply("uciok");
 }
 
+// "setoption name <name> [value <value>]", the name may consist of several words
+static std::pair<std::string, std::string> parseSetOption(std::istringstream& iss)
+{
+	std::string name, value, token;
+	iss >> std::skipws >> token; // "name"
+	while (iss >> token && token != "value")
+		name += (name.empty() ? "" : " ") + token;
+
+	while (iss >> token)
+		value += (value.empty() ? "" : " ") + token;
+
+	return { name, value };
+}
+
+// Option names are case-insensitive
+static bool optionNameIs(std::string_view name, std::string_view option)
+{
+	return std::equal(name.begin(), name.end(), option.begin(), option.end(), [](char a, char b) { return ::tolower(a) == ::tolower(b); });
+}
+
 inline constexpr PieceType parsePromotion(char promotionChar)
 {
 	switch (promotionChar)
@@ -68,6 +102,7 @@ inline constexpr PieceType parsePromotion(char promotionChar)
 	}
 }
 
+// Returns a null move if the move is not legal in this position
 Move parseMove(const std::string &moveStr, const Board &board)
 {
 	const uint8_t from = parseSquare(moveStr.substr(0, 2));
@@ -79,10 +114,16 @@ Move parseMove(const std::string &moveStr, const Board &board)
 		promotion = parsePromotion(moveStr[4]);
 	}
 
-	// Determine if the move is a capture (based on the board state)
-	const bool isCapture = board.isEnemyPiece(to, board.pieceAt(from).color());
+	// Match against the legal moves, which also determines whether it's a capture
+	MoveList moves;
+	board.generateLegalMoves(moves);
+	for (const Move move : moves)
+	{
+		if (move.from() == from && move.to() == to && move.promotion() == promotion)
+			return move;
+	}
 
-	return Move(from, to, isCapture, promotion);
+	return {};
 }
 
 static void parsePosition(std::istringstream &iss, Board& board)
@@ -116,13 +157,121 @@ static void parsePosition(std::istringstream &iss, Board& board)
 		std::string moveString;
 		while (iss >> std::skipws >> moveString)
 		{
-			Move m = parseMove(moveString, board);
-			if (!board.applyMove(m))
+			const Move m = parseMove(moveString, board);
+			if (m.isNull())
 				FATAL("Invalid move: " + moveString);
+
+			board.applyMove(m);
 		}
 	}
 }
 
+// A fixed selection of openings, middlegames and endgames for "bench"
+static constexpr std::string_view benchPositions[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+	"r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 9",
+	"2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 b - - 0 25",
+	"8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+	"6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+	"8/5pk1/6p1/3Q4/8/6P1/5PK1/3q4 b - - 0 40",
+};
+
+void UciServer::bench(size_t depth, size_t threads)
+{
+	// Depth 0 means no depth limit, the bench would never finish
+	if (depth == 0)
+	{
+		printInfo("bench: the depth must be at least 1");
+		return;
+	}
+
+	Analyzer analyzer;
+	analyzer.setThreadCount(threads);
+	SearchLimits limits;
+	limits.depth = depth;
+
+	uint64_t totalNodes = 0;
+	SearchStats totalStats;
+	CTimeElapsed timer(true);
+	for (const std::string_view fen : benchPositions)
+	{
+		// Each position is searched from scratch, so that the node counts don't depend on the order
+		analyzer.startNewGame();
+		analyzer.setInitialPosition(boardFromFEN(fen));
+		const Move bestMove = analyzer.findBestMove(limits);
+		totalNodes += analyzer.nodes();
+		totalStats += analyzer.stats();
+		printInfo(fen, ": bestmove ", bestMove.notation(), ", score ", analyzer.score(), ", nodes ", analyzer.nodes());
+	}
+
+	const uint64_t elapsed = std::max(timer.elapsed(), uint64_t{ 1 });
+	reply("Total time (ms) : ", elapsed);
+	reply("Nodes searched  : ", totalNodes);
+	reply("Nodes/second    : ", totalNodes * 1000 / elapsed);
+	// The share of the beta cutoffs made by the first move searched, a measure of the move ordering
+	reply("1st move cutoffs: ", std::round(totalStats.firstMoveCutoffRate() * 1000.0) / 10.0, '%');
+}
+
+static SearchLimits parseGoCommand(std::istringstream& iss)
+{
+	SearchLimits limits;
+	std::string token;
+	while (iss >> std::skipws >> token)
+	{
+		if (token == "wtime")
+			iss >> limits.time[White];
+		else if (token == "btime")
+			iss >> limits.time[Black];
+		else if (token == "winc")
+			iss >> limits.increment[White];
+		else if (token == "binc")
+			iss >> limits.increment[Black];
+		else if (token == "movestogo")
+			iss >> limits.movesToGo;
+		else if (token == "movetime")
+			iss >> limits.moveTime;
+		else if (token == "depth")
+			iss >> limits.depth;
+		else if (token == "nodes")
+			iss >> limits.nodes;
+		else if (token == "infinite")
+			limits.infinite = true;
+	}
+
+	return limits;
+}
+
+static std::string formatScore(int score)
+{
+	if (!isMateScore(score))
+		return "cp " + std::to_string(score);
+
+	// In moves rather than plies, negative when getting mated
+	const int movesToMate = score > 0 ? (ScoreMate - score + 1) / 2 : -(ScoreMate + score) / 2;
+	return "mate " + std::to_string(movesToMate);
+}
+
+static void printSearchInfo(const SearchInfo& info)
+{
+	std::string pv;
+	for (const Move move : info.pv)
+		pv += ' ' + move.notation();
+
+	const uint64_t nps = info.nodes * 1000 / (uint64_t)std::max(info.timeMs, int64_t{ 1 });
+	reply("info depth ", info.depth, " score ", formatScore(info.score), " nodes ", info.nodes, " nps ", nps, " time ", info.timeMs, " hashfull ", info.hashfull, " pv", pv);
+}
+
+static void printBestMove(Move bestMove)
+{
+	reply("bestmove ", bestMove.isNull() ? "0000" : bestMove.notation());
+}
+
 void UciServer::uci_loop()
 {
 	Analyzer analyzer;
@@ -157,6 +306,7 @@ void UciServer::uci_loop()
 		{
 			analyzer.stop();
 
+			analyzer.startNewGame();
 			analyzer.setInitialPosition(Board{}.setToStartingPosition());
 		}
 		else if (token == "uci")
@@ -165,6 +315,8 @@ void UciServer::uci_loop()
 		}
 		else if (token == "position")
 		{
+			analyzer.stop();
+
 			Board board;
 			parsePosition(is, board);
 			analyzer.setInitialPosition(board);
@@ -174,18 +326,20 @@ void UciServer::uci_loop()
 		}
 		else if (token == "go")
 		{
-			CTimeElapsed timer(true);
-			const Move bestMove = analyzer.findBestMove();
-			const auto time = timer.elapsed();
-
-			reply("bestmove ", bestMove.notation());
-			printInfo("time: ", (float)time * 1e-3f, " s");
+			// go [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <N>] [movetime <ms>] [depth <N>] [nodes <N>] [infinite]
+			analyzer.go(parseGoCommand(is), printSearchInfo, printBestMove);
 		}
 		else if (token == "setoption")
 		{
-			std::string name, value;
-			is >> std::skipws >> name;
-			is >> std::skipws >> value;
+			analyzer.stop();
+
+			const auto [name, value] = parseSetOption(is);
+			if (optionNameIs(name, "Hash"))
+				analyzer.setHashSize(std::clamp<size_t>(std::strtoull(value.c_str(), nullptr, 10), 1, maxHashSizeMb));
+			else if (optionNameIs(name, "Threads"))
+				analyzer.setThreadCount(std::clamp<size_t>(std::strtoull(value.c_str(), nullptr, 10), 1, maxThreadCount));
+			else
+				printInfo("Unknown option ", name);
 		}
 		else if (token == "d")
 		{
@@ -213,10 +367,36 @@ void UciServer::uci_loop()
 			else
 				_printPositions = false;
 		}
+		else if (token == "bench")
+		{
+			// bench [depth] [threads]
+			size_t depth = defaultBenchDepth, threads = 1;
+			is >> std::skipws >> depth >> threads;
+			bench(depth, threads);
+		}
 		else if (token == "perft" || token == "perftd" /* perft debug */)
 		{
-			size_t depth = 3;
+			// perft <depth> [threads <count>] [hash <MB>] [stats]
+			size_t depth = 3, hashSizeMb = 0;
+			PerftOptions options;
 			is >> std::skipws >> depth;
+			for (std::string option; is >> std::skipws >> option; )
+			{
+				if (option == "threads")
+					is >> std::skipws >> options.threads;
+				else if (option == "hash")
+					is >> std::skipws >> hashSizeMb;
+				else if (option == "stats")
+					options.detailedStats = true;
+			}
+
+			// Shared by all the depths below, the shallower runs fill it for the deeper ones
+			std::unique_ptr<PerftHashTable> hashTable;
+			if (hashSizeMb > 0)
+			{
+				hashTable = std::make_unique<PerftHashTable>(hashSizeMb);
+				options.hashTable = hashTable.get();
+			}
 
 			static const PerftPrintFunc printFunc = [](std::string_view move, uint64_t nodeCount) {
 				reply(move, ": ", nodeCount);
@@ -230,16 +410,26 @@ void UciServer::uci_loop()
 
 				CTimeElapsed timer(true);
 				PerftResults results;
-				perft(board, i, results, debugPrint ? printFunc : PerftPrintFunc{});
+				perft(board, i, results, debugPrint ? printFunc : PerftPrintFunc{}, options);
 				const auto elapsed = timer.elapsed();
 
-				reply(i, " - nodes: ", results.nodes
-					   , ", captures: ", results.captures
-					   , ", castles: ", results.castling
-					   , ", en passant: ", results.enPassant
-					   , ", time: ", elapsed, " ms, "
-					   , results.nodes * 1e-3f / (float)elapsed, " MNps"
-				);
+				if (options.detailedStats)
+				{
+					reply(i, " - nodes: ", results.nodes
+						   , ", captures: ", results.captures
+						   , ", castles: ", results.castling
+						   , ", en passant: ", results.enPassant
+						   , ", time: ", elapsed, " ms, "
+						   , results.nodes * 1e-3f / (float)elapsed, " MNps"
+					);
+				}
+				else
+				{
+					reply(i, " - nodes: ", results.nodes
+						   , ", time: ", elapsed, " ms, "
+						   , results.nodes * 1e-3f / (float)elapsed, " MNps"
+					);
+				}
 			}
 		}
 	}
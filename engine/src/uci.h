@@ -8,6 +8,11 @@ class UciServer
 public:
 	UciServer();
 	void run();
+	// Searches the built-in bench positions to the given depth and prints the node total and the speed.
+	// The depth must be at least 1. With one thread, the node total changes only when the search does, so it serves as a signature of the search behavior.
+	void bench(size_t depth = defaultBenchDepth, size_t threads = 1);
+
+	static constexpr size_t defaultBenchDepth = 6;
 
 private:
 	void uci_loop();
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "piece.h"
+
+#include <array>
+#include <stdint.h>
+
+// Zobrist keys, generated at compile time
+struct ZobristKeys
+{
+	std::array<std::array<uint64_t, 64>, 16> pieces {}; // Indexed by Piece::id(), then square
+	std::array<uint64_t, 16> castlingRights {};         // Indexed by the CastlingRights bit mask; 0 for no rights
+	std::array<uint64_t, 8> enPassantFile {};
+	uint64_t blackToMove = 0;
+};
+
+inline constexpr ZobristKeys zobrist = [] {
+	// splitmix64
+	uint64_t state = 0x6A09E667F3BCC909ULL;
+	const auto next = [&state]() noexcept {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	};
+
+	ZobristKeys keys;
+	for (const PieceType type : { Pawn, Knight, Bishop, Rook, Queen, King })
+	{
+		for (const Color color : { White, Black })
+		{
+			for (auto& key : keys.pieces[Piece{ type, color }.id()])
+				key = next();
+		}
+	}
+
+	for (size_t i = 1; i < keys.castlingRights.size(); ++i)
+		keys.castlingRights[i] = next();
+
+	for (auto& key : keys.enPassantFile)
+		key = next();
+
+	keys.blackToMove = next();
+	return keys;
+}();
@@ -0,0 +1,17 @@
+#include "3rdparty/catch2/catch.hpp"
+
+#include "board.h"
+#include "eval.h"
+#include "notation.h"
+
+TEST_CASE("draw with only the kings left", "[eval]")
+{
+	CHECK(isDrawPosition(boardFromFEN("8/8/4k3/8/8/3K4/8/8 w - - 0 1")));
+	CHECK(isDrawPosition(boardFromFEN("k7/8/8/8/8/8/8/7K b - - 0 1")));
+
+	// One more piece of any kind, for either side, is not a draw by this rule
+	CHECK_FALSE(isDrawPosition(boardFromFEN("8/8/4k3/8/8/3K4/4P3/8 w - - 0 1")));
+	CHECK_FALSE(isDrawPosition(boardFromFEN("8/8/4k3/8/8/3K4/8/6n1 w - - 0 1")));
+	CHECK_FALSE(isDrawPosition(boardFromFEN("8/8/4k3/8/8/3K4/8/7q b - - 0 1")));
+	CHECK_FALSE(isDrawPosition(boardFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1")));
+}
@@ -0,0 +1,156 @@
+#include "3rdparty/catch2/catch.hpp"
+
+#include "board.h"
+#include "movepicker.h"
+#include "notation.h"
+#include "perft.h"
+#include "testsettings.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+// Arbitrary scores, so that the history ordering has something to sort
+static const ButterflyHistory testHistory = [] {
+	ButterflyHistory history {};
+	for (size_t side = 0; side < 2; ++side)
+		for (size_t from = 0; from < 64; ++from)
+			for (size_t to = 0; to < 64; ++to)
+				history[side][from][to] = static_cast<int16_t>((from * 37 + to * 11 + side) % 201) - 100;
+	return history;
+}();
+
+// Every legal move must come out of the picker exactly once, whatever the hash move and the refutations are
+static void checkPicker(Board& board, size_t depth)
+{
+	MoveList legalMoves;
+	board.generateLegalMoves(legalMoves);
+
+	const auto firstQuiet = std::find_if(legalMoves.begin(), legalMoves.end(), [](Move m) { return !m.isCapture(); });
+	const Move quiet = firstQuiet != legalMoves.end() ? *firstQuiet : Move{};
+	const auto lastQuiet = std::find_if(std::make_reverse_iterator(legalMoves.end()), std::make_reverse_iterator(legalMoves.begin()), [](Move m) { return !m.isCapture(); });
+	const Move counterMove = lastQuiet != std::make_reverse_iterator(legalMoves.begin()) ? *lastQuiet : Move{};
+	const Move notInPosition{ 0, 63 };
+	const Move hashMoves[] { Move{}, legalMoves.count() > 0 ? legalMoves[legalMoves.count() - 1] : Move{}, notInPosition };
+
+	for (const Move hashMove : hashMoves)
+	{
+		std::vector<Move> picked;
+		MovePicker picker{ board, hashMove, quiet, notInPosition, counterMove, &testHistory };
+
+		// Apart from the hash move: first the captures and promotions that don't lose material, then the quiet moves, then the losing captures
+		enum Group { GoodCaptures, Quiets, BadCaptures } previousGroup = GoodCaptures;
+		int previousHistory = std::numeric_limits<int>::max();
+		for (Move move = picker.next(); !move.isNull(); move = picker.next())
+		{
+			picked.push_back(move);
+			if (move == hashMove)
+				continue;
+
+			const Group group = !move.isCapture() && !move.isPromotion() ? Quiets :
+				(move.isPromotion() || staticExchange(board, move) >= 0 ? GoodCaptures : BadCaptures);
+			if (group < previousGroup)
+				FAIL(move.notation() << " picked out of order");
+			previousGroup = group;
+
+			// The refutations come first, the rest of the quiet moves by their history
+			if (group == Quiets && move != quiet && move != counterMove)
+			{
+				const int history = testHistory[board.sideToMove()][move.from()][move.to()];
+				CHECK(history <= previousHistory);
+				previousHistory = history;
+			}
+		}
+
+		REQUIRE(picked.size() == legalMoves.count());
+		for (const Move move : legalMoves)
+			CHECK(std::count(picked.begin(), picked.end(), move) == 1);
+	}
+
+	if (depth == 0)
+		return;
+
+	for (const Move move : legalMoves)
+	{
+		const auto rollbackInfo = board.applyMove(move);
+		checkPicker(board, depth - 1);
+		board.rollbackMove(move, rollbackInfo);
+	}
+}
+
+TEST_CASE("move picker", "[movepicker]")
+{
+	const char* fens[] {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	};
+
+	for (const char* fen : fens)
+	{
+		Board board = boardFromFEN(fen);
+		checkPicker(board, 2);
+	}
+}
+
+// isLegal() tells apart the moves of other positions without generating the moves, it must agree with the generator on every possible move
+TEST_CASE("legality of moves from other positions", "[movepicker]")
+{
+	const auto suite = loadPerftSuite(settings.epdPath);
+	REQUIRE(!suite.empty());
+
+	for (size_t i = 0; i < suite.size(); i += 4)
+	{
+		Board board = boardFromFEN(suite[i].fen);
+		MoveList legalMoves;
+		board.generateLegalMoves(legalMoves);
+
+		size_t legalCount = 0;
+		for (uint32_t from = 0; from < 64; ++from)
+		{
+			for (uint32_t to = 0; to < 64; ++to)
+			{
+				for (uint32_t kind = 0; kind < 16; ++kind)
+				{
+					const Move move{ static_cast<uint8_t>(from), static_cast<uint8_t>(to), static_cast<MoveKind>(kind) };
+					const bool generated = std::find(legalMoves.begin(), legalMoves.end(), move) != legalMoves.end();
+					const bool legal = board.isLegal(move);
+					if (legal != generated)
+						FAIL(suite[i].fen << ": " << move.notation() << " kind " << kind << (generated ? " is legal" : " is not legal"));
+					legalCount += legal;
+				}
+			}
+		}
+
+		CHECK(legalCount == legalMoves.count());
+	}
+}
+
+static int staticExchange(const char* fen, const char* moveNotation)
+{
+	const Board board = boardFromFEN(fen);
+	MoveList moves;
+	board.generateCaptures(moves);
+	const auto move = std::find_if(moves.begin(), moves.end(), [&](Move m) { return m.notation() == moveNotation; });
+	REQUIRE(move != moves.end());
+	return staticExchange(board, *move);
+}
+
+TEST_CASE("static exchange evaluation", "[movepicker]")
+{
+	// Undefended pawn, also en passant
+	CHECK(staticExchange("k7/8/8/3p4/8/8/8/K2R4 w - - 0 1", "d1d5") == 100);
+	CHECK(staticExchange("k7/8/8/3pP3/8/8/8/K7 w - d6 0 1", "e5d6") == 100);
+	// The queen takes a pawn defended by a pawn
+	CHECK(staticExchange("k7/8/8/3p4/4p3/8/4Q3/K7 w - - 0 1", "e2e4") == -800);
+	// A pawn takes a defended knight
+	CHECK(staticExchange("k7/8/2p5/3n4/4P3/8/8/K7 w - - 0 1", "e4d5") == 200);
+	// A rook takes a pawn defended by a rook: it loses the exchange alone, but wins a pawn with the second rook behind it
+	CHECK(staticExchange("k3r3/8/8/4p3/8/8/4R3/K7 w - - 0 1", "e2e5") == -400);
+	CHECK(staticExchange("k3r3/8/8/4p3/8/8/4R3/K3R3 w - - 0 1", "e2e5") == 100);
+	// The king can't recapture on a square that is still attacked
+	CHECK(staticExchange("k7/1r6/1q6/8/8/8/1P6/K7 b - - 0 1", "b6b2") == 100);
+	CHECK(staticExchange("k7/8/1q6/8/8/8/1P6/K7 b - - 0 1", "b6b2") == -800);
+}
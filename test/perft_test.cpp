@@ -1,96 +1,174 @@
-#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_RUNNER
 #include "3rdparty/catch2/catch.hpp"
 
 #include "notation.h"
 #include "perft.h"
-#include "notation.h"
 #include "board.h"
 #include "system/ctimeelapsed.h"
+#include "testsettings.h"
 
+#include <algorithm>
+#include <atomic>
 #include <charconv>
-#include <fstream>
 #include <iostream>
+#include <optional>
 #include <string_view>
+#include <thread>
 #include <vector>
 
-struct TestPosition {
-	struct Result {
-		size_t depth = 0;
-		uint64_t nodes = 0;
-	};
+TestSettings settings;
+
+// Parses a list of zero-based indices and ranges like "0-9,15", nullopt if any entry is neither
+static std::optional<std::vector<bool>> parsePositionSubset(std::string_view subset, size_t positionCount)
+{
+	std::vector<bool> selected(positionCount, subset.empty());
+	while (!subset.empty())
+	{
+		const size_t comma = std::min(subset.find(','), subset.size());
+		const std::string_view item = subset.substr(0, comma);
+		subset.remove_prefix(std::min(comma + 1, subset.size()));
+
+		const char* const itemEnd = item.data() + item.size();
+		size_t first = 0;
+		std::from_chars_result parsed = std::from_chars(item.data(), itemEnd, first);
+		size_t last = first;
+		if (parsed.ec == std::errc{} && parsed.ptr != itemEnd && *parsed.ptr == '-')
+			parsed = std::from_chars(parsed.ptr + 1, itemEnd, last);
+
+		if (parsed.ec != std::errc{} || parsed.ptr != itemEnd || last < first)
+			return std::nullopt;
+
+		for (size_t i = first; i <= last && i < positionCount; ++i)
+			selected[i] = true;
+	}
 
-	std::string fen;
-	std::vector<Result> nodeCountForDepth;
-};
+	return selected;
+}
 
-static std::vector<TestPosition> parsePositions(std::string_view path)
+TEST_CASE("perft", "[perft]")
 {
-	std::ifstream file(path.data());
-	if (!file.is_open())
-		FAIL("Could not open file");
+	const auto positions = loadPerftSuite(settings.epdPath);
+	REQUIRE(!positions.empty());
 
-	std::vector<TestPosition> positions;
+	// Every selected (position, depth) pair is a separate job; the biggest ones go first so that no thread is left with a long job at the end
+	struct Job {
+		size_t position = 0;
+		PerftSuitePosition::Depth expected;
+		uint64_t nodes = 0;
+	};
 
-	std::string line;
-	while (std::getline(file, line))
+	std::vector<Job> jobs;
+	// Already validated by main()
+	const auto selected = parsePositionSubset(settings.positions, positions.size()).value();
+	for (size_t i = 0; i < positions.size(); ++i)
 	{
-		std::string token;
-		std::istringstream ss{line};
-		if (line.empty() || line.front() == '#')
-			continue;
-
-		while (std::getline(ss, token, ';'))
+		for (const auto& depth : positions[i].expectedNodes)
 		{
-			std::istringstream localstream{ token };
-			if (token.starts_with('D'))
-			{
-				std::string depthString, nodeCountString;
-				localstream >> std::skipws >> depthString >> nodeCountString;
-
-				uint32_t depth = 0;
-				std::from_chars(depthString.data() + 1, depthString.data() + depthString.size(), depth);
+			if (selected[i] && depth.depth <= settings.maxDepth && depth.nodes <= settings.maxNodes)
+				jobs.push_back({ i, depth });
+		}
+	}
 
-				uint64_t nodeCount = 0;
-				std::from_chars(nodeCountString.data(), nodeCountString.data() + nodeCountString.size(), nodeCount);
+	std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.expected.nodes > b.expected.nodes; });
 
-				positions.back().nodeCountForDepth.push_back({ depth, nodeCount });
-			}
-			else
+	// Catch2 assertions are not thread-safe, so the workers only count the nodes and the checks are all done here afterwards
+	CTimeElapsed timer(true);
+	std::atomic<size_t> nextJob = 0;
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < std::max(settings.threads, size_t{ 1 }); ++t)
+	{
+		workers.emplace_back([&] {
+			for (size_t j = nextJob++; j < jobs.size(); j = nextJob++)
 			{
-				// FEN
-				positions.push_back({ token, {} });
+				Board board = boardFromFEN(positions[jobs[j].position].fen);
+
+				PerftResults results;
+				perft(board, jobs[j].expected.depth, results);
+				jobs[j].nodes = results.nodes;
 			}
-		}
+		});
 	}
 
-	return positions;
-}
+	for (auto& worker : workers)
+		worker.join();
 
-static void checkPosition(const TestPosition& position)
-{
-	Board board;
-	std::istringstream iss{ position.fen };
-	parseFEN(iss, board);
+	std::cout << "Checked " << jobs.size() << " depths of " << std::count(selected.begin(), selected.end(), true) << " positions in " << timer.elapsed() * 1e-3f << " seconds" << std::endl;
 
-	for (const auto& depth: position.nodeCountForDepth)
+	for (const Job& job : jobs)
 	{
-		std::cout << "depth " << depth.depth << std::endl;
-		PerftResults results;
-		perft(board, depth.depth, results);
-		CHECK(results.nodes == depth.nodes);
+		INFO(positions[job.position].fen << " (#" << job.position << ") at depth " << job.expected.depth);
+		CHECK(job.nodes == job.expected.nodes);
 	}
 }
 
-TEST_CASE("perft", "[perft]")
+TEST_CASE("parallel perft", "[perft]")
 {
-	const auto positions = parsePositions("../test/standard.epd");
+	// The same breakdown as the single-threaded perft, for both the root split (2 threads) and the deeper split (8 threads),
+	// with and without the hash table
+	const char* fens[] {
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	};
 
-	CTimeElapsed timer(true);
-	for (size_t i = 0; i < positions.size(); ++i)
+	for (const char* fen : fens)
 	{
-		std::cout << "Checking " << positions[i].fen << " (" << i << " out of " << positions.size() << ")...\n";
-		checkPosition(positions[i]);
+		Board board = boardFromFEN(fen);
+
+		PerftResults expected;
+		perft(board, 4, expected, {}, { .detailedStats = true });
+		PerftHashTable hashTable{ 1 };
+		for (const PerftOptions& options : { PerftOptions{ 2, nullptr, true }, PerftOptions{ 8, nullptr, true }, PerftOptions{ 1, &hashTable, true }, PerftOptions{ 8, &hashTable, true } })
+		{
+			PerftResults results;
+			perft(board, 4, results, {}, options);
+			CHECK(results.nodes == expected.nodes);
+			CHECK(results.captures == expected.captures);
+			CHECK(results.castling == expected.castling);
+			CHECK(results.enPassant == expected.enPassant);
+		}
 	}
+}
 
-	std::cout << "Total time: " << timer.elapsed() * 1e-3f << " seconds" << std::endl;
-}
\ No newline at end of file
+TEST_CASE("perft stats", "[perft]")
+{
+	// Kiwipete, https://www.chessprogramming.org/Perft_Results
+	Board board = boardFromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+	PerftResults detailed;
+	perft(board, 3, detailed, {}, { .detailedStats = true });
+	CHECK(detailed.nodes == 97862);
+	CHECK(detailed.captures == 17102);
+	CHECK(detailed.castling == 3162);
+	CHECK(detailed.enPassant == 45);
+
+	// Only the nodes are counted by default
+	PerftResults bulk;
+	perft(board, 3, bulk);
+	CHECK(bulk.nodes == 97862);
+	CHECK(bulk.captures == 0);
+}
+
+int main(int argc, char* argv[])
+{
+	Catch::Session session;
+
+	using namespace Catch::clara;
+	const auto cli = session.cli()
+		| Opt(settings.epdPath, "path")["--epd"]("perft suite to check (default ../test/standard.epd)")
+		| Opt(settings.maxDepth, "depth")["--max-depth"]("skip the depths above this one")
+		| Opt(settings.maxNodes, "nodes")["--max-nodes"]("skip the depths with more nodes than this")
+		| Opt([](const std::string& list) {
+				if (!parsePositionSubset(list, 0))
+					return ParserResult::runtimeError("Malformed position list '" + list + "', expected e. g. 0-9,15");
+
+				settings.positions = list;
+				return ParserResult::ok(ParseResultType::Matched);
+			}, "list")["--positions"]("zero-based positions to check, e. g. 0-9,15 (default all)")
+		| Opt(settings.threads, "count")["--threads"]("positions checked concurrently (default all cores)");
+	session.cli(cli);
+
+	if (const int result = session.applyCommandLine(argc, argv); result != 0)
+		return result;
+
+	return session.run();
+}
@@ -0,0 +1,289 @@
+#include "3rdparty/catch2/catch.hpp"
+
+#include "analyzer.h"
+#include "board.h"
+#include "eval.h"
+#include "notation.h"
+#include "search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+static SearchLimits depthLimit(size_t depth)
+{
+	SearchLimits limits;
+	limits.depth = depth;
+	return limits;
+}
+
+// Quiescence search with nothing but alpha-beta pruning: standing pat or any capture and promotion, or any evasion in check
+static int quiescence(Board& board, int ply, int alpha, int beta)
+{
+	if (isDrawPosition(board))
+		return 0;
+
+	const bool inCheck = board.isInCheck(board.sideToMove());
+	int best = inCheck ? -ScoreMate + ply : (board.sideToMove() == White ? eval(board) : -eval(board));
+
+	MoveList generated;
+	if (inCheck)
+		board.generateLegalMoves(generated);
+	else
+		board.generateCaptures(generated);
+
+	// The most valuable victims first, or the capture sequences take ages to search through
+	std::vector<Move> moves{ generated.begin(), generated.end() };
+	const auto victimValue = [&board](Move move) {
+		return move.isEnPassant() ? pieceValue(Pawn) : pieceValue(board.pieceAt(move.to()).type());
+	};
+	std::stable_sort(moves.begin(), moves.end(), [&](Move a, Move b) { return victimValue(a) > victimValue(b); });
+
+	for (Move move : moves)
+	{
+		if (best >= beta)
+			break;
+
+		const auto rollbackInfo = board.applyMove(move);
+		best = std::max(best, -quiescence(board, ply + 1, -beta, -std::max(alpha, best)));
+		board.rollbackMove(move, rollbackInfo);
+	}
+
+	return best;
+}
+
+// Plain minimax over every move, the reference that alpha-beta pruning must agree with
+static int minimax(Board& board, int depth, int ply)
+{
+	if (ply > 0 && isDrawPosition(board))
+		return 0;
+
+	if (depth == 0)
+		return quiescence(board, ply, -ScoreInfinity, ScoreInfinity);
+
+	MoveList moves;
+	board.generateLegalMoves(moves);
+	if (moves.count() == 0)
+		return board.isInCheck(board.sideToMove()) ? -ScoreMate + ply : 0;
+
+	int best = -ScoreInfinity;
+	for (Move move : moves)
+	{
+		const auto rollbackInfo = board.applyMove(move);
+		best = std::max(best, -minimax(board, depth - 1, ply + 1));
+		board.rollbackMove(move, rollbackInfo);
+	}
+
+	return best;
+}
+
+TEST_CASE("alpha-beta agrees with minimax", "[search]")
+{
+	// The reference quiescence search is slow in the positions full of captures, they are only searched to depth 2
+	const std::pair<std::string, int> positions[] {
+		{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3 },
+		{ "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2 },
+		{ "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 3 },
+		{ "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 2 },
+		{ "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3 },
+	};
+
+	for (const auto& [fen, maxDepth] : positions)
+	{
+		for (int depth = 1; depth <= maxDepth; ++depth)
+		{
+			Board board = boardFromFEN(fen);
+			const SearchResult result = Search{ board, depthLimit((size_t)depth) }.run();
+			INFO(fen << " depth " << depth);
+			CHECK(result.score == minimax(board, depth, 0));
+			CHECK(board.isLegal(result.bestMove));
+		}
+	}
+}
+
+TEST_CASE("search finds mates", "[search]")
+{
+	// Mate in 1: Ra8#
+	SearchResult result = Search{ boardFromFEN("7k/8/6K1/8/8/8/8/R7 w - - 0 1"), depthLimit(2) }.run();
+	CHECK(result.bestMove.notation() == "a1a8");
+	CHECK(result.score == ScoreMate - 1);
+
+	// Mate in 2: 1. Kb6 Kb8 2. Rh8#
+	result = Search{ boardFromFEN("k7/8/2K5/8/8/8/8/7R w - - 0 1"), depthLimit(4) }.run();
+	CHECK(isMateScore(result.score));
+	CHECK(result.score == ScoreMate - 3);
+
+	// Checkmated and stalemated: no move to make
+	result = Search{ boardFromFEN("7k/6Q1/6K1/8/8/8/8/8 b - - 0 1"), depthLimit(3) }.run();
+	CHECK(result.bestMove.isNull());
+	CHECK(result.score == -ScoreMate);
+
+	result = Search{ boardFromFEN("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"), depthLimit(3) }.run();
+	CHECK(result.bestMove.isNull());
+	CHECK(result.score == 0);
+}
+
+TEST_CASE("quiescence search sees the recaptures", "[search]")
+{
+	// Qxe4 wins a pawn at depth 1, but dxe4 takes the queen right back
+	SearchResult result = Search{ boardFromFEN("k7/8/8/3p4/4p3/8/4Q3/K7 w - - 0 1"), depthLimit(1) }.run();
+	CHECK(result.bestMove.notation() != "e2e4");
+
+	// Rxd5 is safe here, with nothing left to recapture
+	result = Search{ boardFromFEN("k7/8/8/3p4/8/8/8/K2R4 w - - 0 1"), depthLimit(1) }.run();
+	CHECK(result.bestMove.notation() == "d1d5");
+}
+
+TEST_CASE("search with a transposition table", "[search]")
+{
+	TranspositionTable tt{ 1 };
+	for (const auto& fen : { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" })
+	{
+		const Board board = boardFromFEN(fen);
+		const SearchResult withoutTT = Search{ board, depthLimit(5) }.run();
+
+		tt.newSearch();
+		const SearchResult withTT = Search{ board, depthLimit(5), &tt }.run();
+		CHECK(withTT.nodes < withoutTT.nodes);
+		CHECK(board.isLegal(withTT.bestMove));
+
+		// The second search of the same position is mostly answered by the table
+		tt.newSearch();
+		const SearchResult again = Search{ board, depthLimit(5), &tt }.run();
+		CHECK(again.nodes < withTT.nodes);
+	}
+
+	// Mate scores are adjusted for the ply they are found at
+	tt.clear();
+	const SearchResult mate = Search{ boardFromFEN("k7/8/2K5/8/8/8/8/7R w - - 0 1"), depthLimit(6), &tt }.run();
+	CHECK(mate.score == ScoreMate - 3);
+}
+
+TEST_CASE("parallel search", "[search]")
+{
+	Analyzer analyzer;
+	analyzer.setThreadCount(4);
+
+	analyzer.setInitialPosition(boardFromFEN("k7/8/2K5/8/8/8/8/7R w - - 0 1"));
+	CHECK(analyzer.findBestMove(depthLimit(6)).notation() == "c6b6");
+	CHECK(analyzer.score() == ScoreMate - 3);
+
+	const Board board = boardFromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	analyzer.setInitialPosition(board);
+	SearchLimits limits;
+	limits.moveTime = 200;
+	CHECK(board.isLegal(analyzer.findBestMove(limits)));
+	CHECK(analyzer.nodes() > 0);
+	CHECK(analyzer.stats().betaCutoffs > 0);
+
+	// The node limit is for all the threads together
+	limits = {};
+	limits.nodes = 30'000;
+	CHECK(board.isLegal(analyzer.findBestMove(limits)));
+	CHECK(analyzer.nodes() <= limits.nodes);
+}
+
+TEST_CASE("move ordering statistics", "[search]")
+{
+	const SearchResult result = Search{ boardFromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"), depthLimit(5) }.run();
+	REQUIRE(result.stats.betaCutoffs > 0);
+	CHECK(result.stats.firstMoveCutoffs <= result.stats.betaCutoffs);
+	// Well below this, something is wrong with the ordering
+	CHECK(result.stats.firstMoveCutoffRate() > 0.8);
+}
+
+TEST_CASE("search limits", "[search]")
+{
+	const Board board = boardFromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+	SECTION("nodes")
+	{
+		SearchLimits limits;
+		limits.nodes = 10'000;
+		const SearchResult result = Search{ board, limits }.run();
+		CHECK(result.nodes <= limits.nodes);
+		CHECK(board.isLegal(result.bestMove));
+	}
+
+	SECTION("movetime")
+	{
+		SearchLimits limits;
+		limits.moveTime = 200;
+		const auto start = std::chrono::steady_clock::now();
+		const SearchResult result = Search{ board, limits }.run();
+		// Wall clock time on a shared machine: only a gross overrun is an error, the limits themselves are checked below
+		CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(limits.moveTime * 2));
+		CHECK(result.depth > 1);
+		CHECK(board.isLegal(result.bestMove));
+	}
+
+	SECTION("clock")
+	{
+		SearchLimits limits;
+		limits.time[White] = 1000;
+		limits.time[Black] = 1;
+		const auto start = std::chrono::steady_clock::now();
+		const SearchResult result = Search{ board, limits }.run();
+		CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(limits.time[White] / 3 * 2));
+		CHECK(board.isLegal(result.bestMove));
+	}
+
+	SECTION("time manager limits")
+	{
+		SearchLimits limits;
+		CHECK(TimeManager{ limits, White }.hardLimitMs() == 0);
+
+		// The move overhead is kept in reserve
+		limits.moveTime = 200;
+		TimeManager timeManager{ limits, White };
+		CHECK(timeManager.softLimitMs() == 180);
+		CHECK(timeManager.hardLimitMs() == 180);
+
+		// A 30th of the clock for each move, up to three times that if the iteration is worth finishing
+		limits = {};
+		limits.time[White] = 1000;
+		limits.time[Black] = 1;
+		timeManager = TimeManager{ limits, White };
+		CHECK(timeManager.softLimitMs() == 32);
+		CHECK(timeManager.hardLimitMs() == 96);
+		CHECK(timeManager.hardLimitMs() < limits.time[White] / 3);
+
+		// Plus most of the increment
+		limits.increment[White] = 100;
+		timeManager = TimeManager{ limits, White };
+		CHECK(timeManager.softLimitMs() == 32 + 75);
+		CHECK(timeManager.hardLimitMs() == (32 + 75) * 3);
+
+		// The last move before the time control may use the whole clock, but no more
+		limits.movesToGo = 1;
+		timeManager = TimeManager{ limits, White };
+		CHECK(timeManager.softLimitMs() == 980);
+		CHECK(timeManager.hardLimitMs() == 980);
+	}
+
+	SECTION("stop")
+	{
+		// The first iteration completes regardless, so that there is a move to play
+		const std::atomic<bool> stop = true;
+		const SearchResult result = Search{ board, {}, nullptr, &stop }.run();
+		CHECK(result.depth == 1);
+		CHECK(board.isLegal(result.bestMove));
+	}
+
+	SECTION("infos")
+	{
+		std::vector<SearchInfo> infos;
+		const SearchResult result = Search{ board, depthLimit(4) }.run([&](const SearchInfo& info) { infos.push_back(info); });
+		REQUIRE(infos.size() == 4);
+		for (size_t i = 0; i < infos.size(); ++i)
+		{
+			CHECK(infos[i].depth == i + 1);
+			CHECK(infos[i].pv.size() == i + 1);
+		}
+
+		CHECK(infos.back().pv.front() == result.bestMove);
+		CHECK(infos.back().score == result.score);
+	}
+}
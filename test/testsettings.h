@@ -0,0 +1,17 @@
+#pragma once
+
+#include <limits>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+// Command line options of the tests, parsed in main() (perft_test.cpp)
+struct TestSettings {
+	std::string epdPath = "../test/standard.epd";
+	size_t maxDepth = std::numeric_limits<size_t>::max();
+	uint64_t maxNodes = std::numeric_limits<uint64_t>::max();
+	std::string positions; // E. g. "0-9,15"; empty means all
+	size_t threads = std::thread::hardware_concurrency();
+};
+
+extern TestSettings settings;
@@ -0,0 +1,67 @@
+#include "3rdparty/catch2/catch.hpp"
+
+#include "transpositiontable.h"
+
+TEST_CASE("transposition table", "[tt]")
+{
+	TranspositionTable tt{ 1 };
+	const TTEntry entry{ Move{ 12, 28, DoublePawnPush }, -1234, 7, LowerBound };
+
+	TTEntry probed;
+	CHECK(!tt.probe(0x1234'5678'9ABC'DEF0ULL, probed));
+
+	tt.store(0x1234'5678'9ABC'DEF0ULL, entry);
+	REQUIRE(tt.probe(0x1234'5678'9ABC'DEF0ULL, probed));
+	CHECK(probed.move == entry.move);
+	CHECK(probed.score == entry.score);
+	CHECK(probed.depth == entry.depth);
+	CHECK(probed.bound == entry.bound);
+
+	// Same bucket, different position
+	CHECK(!tt.probe(0x1234'5678'9ABC'DEF0ULL ^ (1ULL << 63), probed));
+
+	SECTION("a result without a move keeps the move of the earlier one")
+	{
+		tt.store(0x1234'5678'9ABC'DEF0ULL, { Move{}, 50, 9, UpperBound });
+		REQUIRE(tt.probe(0x1234'5678'9ABC'DEF0ULL, probed));
+		CHECK(probed.move == entry.move);
+		CHECK(probed.score == 50);
+		CHECK(probed.bound == UpperBound);
+	}
+
+	SECTION("replacement within a bucket")
+	{
+		// Five positions for a bucket of four: the shallowest one goes
+		const uint64_t sameBucket = 1ULL << 40;
+		for (uint64_t i = 1; i <= 4; ++i)
+			tt.store(0x1234'5678'9ABC'DEF0ULL + i * sameBucket, { Move{}, 0, static_cast<uint8_t>(10 + i), ExactBound });
+
+		CHECK(!tt.probe(0x1234'5678'9ABC'DEF0ULL, probed));
+		for (uint64_t i = 1; i <= 4; ++i)
+			CHECK(tt.probe(0x1234'5678'9ABC'DEF0ULL + i * sameBucket, probed));
+
+		// Entries from an older search are replaced before the deeper ones of the current search
+		tt.newSearch();
+		tt.store(0x1234'5678'9ABC'DEF0ULL, entry);
+		CHECK(tt.probe(0x1234'5678'9ABC'DEF0ULL, probed));
+		CHECK(!tt.probe(0x1234'5678'9ABC'DEF0ULL + 1 * sameBucket, probed));
+	}
+
+	SECTION("hashfull")
+	{
+		for (uint64_t i = 0; i < 1'000'000; ++i)
+			tt.store(i * 0x9E37'79B9'7F4A'7C15ULL, { Move{}, 0, 1, ExactBound });
+		CHECK(tt.hashfull() == 1000);
+
+		// Only the entries of the current search count
+		tt.newSearch();
+		CHECK(tt.hashfull() == 0);
+	}
+
+	SECTION("clear")
+	{
+		tt.clear();
+		CHECK(!tt.probe(0x1234'5678'9ABC'DEF0ULL, probed));
+		CHECK(tt.hashfull() == 0);
+	}
+}